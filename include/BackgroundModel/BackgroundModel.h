@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+// Running per-pixel median of the empty frames it is offered. Every sample moves the estimate
+// one grey level towards itself, which settles on the temporal median of a stationary pixel,
+// ignores the odd outlier and follows slow drift. Workers offer frames without ever blocking,
+// a low priority thread folds them in.
+class BackgroundModel
+{
+public:
+    // At most one sample is taken per sampleInterval
+    explicit BackgroundModel(std::chrono::milliseconds sampleInterval);
+
+    // Model thread only. Restarts the estimate from this frame (CV_8UC1).
+    void seed(const cv::Mat &background);
+
+    // Workers. Copies the frame if a sample is due and the model thread has taken the last one,
+    // otherwise returns false right away.
+    bool offer(const cv::Mat &frame);
+
+    // Model thread only. Waits up to timeout for an offered frame and folds it into the
+    // estimate, returns false if none came.
+    bool update(std::chrono::milliseconds timeout);
+
+    // Model thread only
+    const cv::Mat &estimate() const { return estimate_; }
+    uint64_t samples() const { return samples_.load(std::memory_order_relaxed); }
+
+private:
+    const int64_t intervalNs_;
+    std::atomic<int64_t> nextSampleNs_{0};
+    std::mutex mutex_;
+    std::condition_variable offered_;
+    cv::Mat pending_; // Offered, not yet folded in
+    bool hasPending_ = false;
+    cv::Mat sample_; // Model thread only, swapped with pending_ so both buffers are reused
+    cv::Mat estimate_;
+    std::atomic<uint64_t> samples_{0};
+};
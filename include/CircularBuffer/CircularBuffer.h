@@ -12,6 +12,7 @@ public:
     std::vector<uint8_t> get(size_t index) const;
     const uint8_t *getPointer(size_t index) const;
     size_t size() const;
+    size_t imageSize() const { return imageSize_; }
     bool isFull() const;
     void clear();
 
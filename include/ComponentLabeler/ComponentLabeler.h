@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Blobs (8-connected foreground) and holes (4-connected background that does not reach the
+// mask edge) of a binary mask, the same topology cv::findContours traces. The mask is cut into
+// row runs and the runs are joined with union-find in a single pass, accumulating the stats
+// per run, so the cost follows the number of runs rather than the number of contours.
+// Contours are only traced on request, for one blob at a time.
+class ComponentLabeler
+{
+public:
+    struct Blob
+    {
+        int area = 0; // Pixels
+        cv::Rect bbox;
+        double sumX = 0.0; // First order moments, the centroid is sumX / area
+        double sumY = 0.0;
+        int holeCount = 0;
+        int holeArea = 0;
+        int smallestHole = 0; // Pixels of the smallest hole, 0 without holes
+        int parentHole = -1;  // Hole the blob sits in, -1 at the top level
+    };
+
+    struct Hole
+    {
+        int area = 0;
+        cv::Rect bbox;
+        int owner = -1; // Blob around the hole
+    };
+
+    // Any non-zero pixel is foreground. Coordinates are relative to the mask.
+    void label(const cv::Mat &mask);
+
+    const std::vector<Blob> &blobs() const { return blobs_; }
+    const std::vector<Hole> &holes() const { return holes_; }
+
+    // Draws only this blob (255) into a mask of its bounding box, leaving out blobs in its holes
+    void renderBlob(int blob, cv::Mat &mask) const;
+
+    // cv::findContours on the blob alone (RETR_CCOMP): one outer contour first, then its holes.
+    // offset is added to every point, like the findContours parameter.
+    void traceBlob(int blob, const cv::Point &offset, std::vector<std::vector<cv::Point>> &contours,
+                   std::vector<cv::Vec4i> &hierarchy) const;
+    // Same, rendering into the caller's mask, so several threads can trace blobs of one labeling.
+    // The mask is reused as long as it is large enough.
+    void traceBlob(int blob, const cv::Point &offset, std::vector<std::vector<cv::Point>> &contours,
+                   std::vector<cv::Vec4i> &hierarchy, cv::Mat &mask) const;
+
+private:
+    struct Run
+    {
+        int y;
+        int x0;
+        int x1; // Inclusive
+        int parent;
+        bool foreground;
+    };
+
+    int find(int run);
+    void unite(int a, int b);
+    int runCovering(int y, int x) const;
+    void drawBlob(int blob, cv::Mat &mask) const; // Into a mask of the bbox size
+
+    std::vector<Run> runs_;
+    std::vector<int> rowStart_;    // First run of every row, plus the end
+    std::vector<uint8_t> exterior_; // Per root run: background reaching the mask edge
+    std::vector<int> component_;   // Per run: blob or hole index, -1 for exterior background
+    std::vector<Blob> blobs_;
+    std::vector<Hole> holes_;
+    mutable cv::Mat scratch_;
+};
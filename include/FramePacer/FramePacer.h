@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Releases frames at a fixed rate without burning a core: sleeps while the next
+// deadline is far away and only spins for the last stretch. When the thread wakes
+// up late, every frame that became due is released at once so the average rate
+// holds. A frame rate <= 0 means free-run, where the caller applies backpressure.
+class FramePacer
+{
+public:
+    static constexpr size_t HistogramBins = 8;
+
+    struct Stats
+    {
+        double targetIntervalUs = 0.0;
+        double meanIntervalUs = 0.0;
+        double maxIntervalUs = 0.0;
+        uint64_t frames = 0;
+        // Achieved interval relative to the target, see binLabel()
+        std::array<uint64_t, HistogramBins> histogram{};
+    };
+
+    explicit FramePacer(double frameRate,
+                        std::chrono::microseconds spinWindow = std::chrono::microseconds(50),
+                        size_t maxBurst = 1000);
+
+    // Restart the schedule from now, e.g. after a pause
+    void reset();
+
+    // Pacing thread only. Blocks until the next deadline and returns how many frames are due (>= 1)
+    size_t waitNext();
+
+    // Free-run only: record that a frame went out
+    void markFrame();
+
+    bool freeRun() const { return targetNs_ <= 0; }
+    Stats stats() const; // Any thread
+    static const char *binLabel(size_t bin);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void record(int64_t intervalNs, uint64_t frames);
+
+    int64_t targetNs_;
+    int64_t spinNs_;
+    size_t maxBurst_;
+    clock::time_point next_;
+    clock::time_point last_;
+    bool started_ = false;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> totalNs_{0};
+    std::atomic<uint64_t> maxNs_{0};
+    std::array<std::atomic<uint64_t>, HistogramBins> histogram_{};
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+class FramePool;
+
+// Reference-counted view of a frame whose pixels live in memory owned by the
+// producer (e.g. an announced EGrabber DMA buffer). The slot is returned to the
+// producer once the last handle referencing it is dropped.
+class FrameHandle
+{
+public:
+    FrameHandle() = default;
+    FrameHandle(const FrameHandle &other);
+    FrameHandle(FrameHandle &&other) noexcept;
+    FrameHandle &operator=(const FrameHandle &other);
+    FrameHandle &operator=(FrameHandle &&other) noexcept;
+    ~FrameHandle();
+
+    const uint8_t *data() const;
+    uint64_t frameId() const;
+    uint64_t timestamp() const;
+    size_t slot() const { return slot_; }
+    explicit operator bool() const { return pool_ != nullptr; }
+    void reset();
+
+private:
+    friend class FramePool;
+    FrameHandle(FramePool *pool, size_t slot) : pool_(pool), slot_(slot) {}
+
+    FramePool *pool_ = nullptr;
+    size_t slot_ = 0;
+};
+
+class FramePool
+{
+public:
+    explicit FramePool(size_t slotCount);
+
+    // Producer thread only
+    bool acquire(size_t &slot);
+    void publish(size_t slot, const uint8_t *data, uint64_t frameId, uint64_t timestamp);
+
+    // Hand every slot whose last reference has gone back to the producer.
+    // onReleased(slot) is called before the slot becomes available to acquire() again.
+    template <typename OnReleased>
+    size_t reclaim(OnReleased &&onReleased)
+    {
+        if (pendingReleases_.load(std::memory_order_acquire) == 0)
+            return 0;
+
+        size_t reclaimed = 0;
+        for (size_t i = 0; i < slotCount_; i++)
+        {
+            if (slots_[i].released.exchange(false, std::memory_order_acq_rel))
+            {
+                pendingReleases_.fetch_sub(1, std::memory_order_relaxed);
+                onReleased(i);
+                freeSlots_.push_back(i);
+                reclaimed++;
+            }
+        }
+        freeCount_.store(freeSlots_.size(), std::memory_order_relaxed);
+        return reclaimed;
+    }
+
+    // Any thread
+    FrameHandle adopt(size_t slot); // Take over the reference created by publish()
+    FrameHandle get(size_t slot);   // Add a new reference to a published slot
+
+    size_t capacity() const { return slotCount_; }
+    size_t freeCount() const { return freeCount_.load(std::memory_order_relaxed); }
+    size_t minFreeCount() const { return minFreeCount_.load(std::memory_order_relaxed); }
+
+private:
+    friend class FrameHandle;
+
+    struct Slot
+    {
+        std::atomic<int> refs{0};
+        std::atomic<bool> released{false};
+        const uint8_t *data = nullptr;
+        uint64_t frameId = 0;
+        uint64_t timestamp = 0;
+    };
+
+    void retain(size_t slot);
+    void release(size_t slot);
+
+    size_t slotCount_;
+    std::unique_ptr<Slot[]> slots_;
+    std::vector<size_t> freeSlots_; // Only touched by the producer thread
+    std::atomic<size_t> pendingReleases_{0};
+    std::atomic<size_t> freeCount_{0};
+    std::atomic<size_t> minFreeCount_{0};
+};
+
+// Frame pool for producers without one of their own. Frames whose buffers do not
+// outlive the delivery (callback buffers, a grabber buffer requeued right away) are
+// copied into memory the staging owns; with copyFrames off the slot just references
+// the producer's pixels, for frames that stay valid for the whole run (a mapped
+// recording). A slot is only reused once every handle to it is gone, so a frame
+// still being analyzed is never overwritten.
+class FrameStaging
+{
+public:
+    FrameStaging(size_t slotCount, size_t imageSize, bool copyFrames = true);
+
+    // Producer thread only. Returns false without staging when every slot is still referenced
+    bool stage(const uint8_t *pixels, uint64_t frameId, uint64_t timestamp, size_t &slot);
+
+    FramePool &pool() { return pool_; }
+
+private:
+    FramePool pool_;
+    size_t imageSize_;
+    std::vector<uint8_t> memory_;
+};
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// What travels between acquisition and its consumers. The pixels stay where
+// they are (frame pool slot or camera buffer), only this descriptor is copied.
+struct FrameDescriptor
+{
+    size_t slot = 0;        // shared.framePool slot, a grabber buffer or a staging copy
+    uint64_t frameId = 0;   // Camera frame id, or a running counter for simulated sources
+    uint64_t timestamp = 0; // Camera timestamp as reported by the source
+    int64_t enqueueNs = 0;  // steady_clock time of the handoff, for latency measurement
+    uint64_t sequence = 0;  // Dense dispatch order, used to put results back in order
+};
+
+// Lets ring consumers sleep after spinning without the producer paying for a
+// mutex on every push: it only locks when someone is actually parked.
+class ConsumerParker
+{
+public:
+    template <typename ReadyPredicate>
+    void park(ReadyPredicate ready)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        parked_.fetch_add(1, std::memory_order_relaxed);
+        // Pairs with the fence in notify(): either the consumer sees the new item
+        // before sleeping, or the producer sees it parked and wakes it up
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Timed wait so a stop request without wake() is still noticed
+        condition_.wait_for(lock, std::chrono::milliseconds(5), ready);
+        parked_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            condition_.notify_one();
+        }
+    }
+
+    void wakeAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        condition_.notify_all();
+    }
+
+private:
+    std::atomic<int> parked_{0};
+    std::mutex mutex_;
+    std::condition_variable condition_;
+};
+
+// Spin on tryPop for a while, then park until an item arrives or shouldStop() is true
+template <typename Ring, typename T, typename StopPredicate>
+bool spinThenPark(Ring &ring, ConsumerParker &parker, T &item, StopPredicate &shouldStop, size_t spinIterations)
+{
+    while (true)
+    {
+        for (size_t i = 0; i < spinIterations; i++)
+        {
+            if (ring.tryPop(item))
+                return true;
+            if ((i & 63) == 63)
+            {
+                if (shouldStop())
+                    return false;
+                std::this_thread::yield();
+            }
+        }
+        if (shouldStop())
+            return false;
+        parker.park([&]()
+                    { return !ring.empty() || shouldStop(); });
+    }
+}
+
+// Bounded single-producer/single-consumer ring. tryPush/tryPop are wait-free;
+// waitPop spins for a while and then parks the consumer on a condition variable.
+// The producer only touches the mutex when the consumer is actually parked.
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+    {
+        size_t rounded = 2;
+        while (rounded < capacity)
+            rounded <<= 1;
+        buffer_.resize(rounded);
+        mask_ = rounded - 1;
+    }
+
+    // Producer thread only
+    bool tryPush(const T &item)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_)
+            {
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        buffer_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        parker_.notify();
+        return true;
+    }
+
+    // Consumer thread only
+    bool tryPop(T &item)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_)
+        {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_)
+                return false;
+        }
+        item = buffer_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Returns false without an item once shouldStop() is true.
+    template <typename StopPredicate>
+    bool waitPop(T &item, StopPredicate shouldStop, size_t spinIterations = 2000)
+    {
+        return spinThenPark(*this, parker_, item, shouldStop, spinIterations);
+    }
+
+    // Wake a parked consumer, e.g. on shutdown or pause
+    void wake() { parker_.wakeAll(); }
+
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+    uint64_t overflowCount() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<size_t> head_{0}; // Written by the consumer
+    size_t cachedTail_ = 0;                   // Consumer's last view of tail_
+    alignas(64) std::atomic<size_t> tail_{0}; // Written by the producer
+    size_t cachedHead_ = 0;                   // Producer's last view of head_
+    alignas(64) std::atomic<uint64_t> overflows_{0};
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    ConsumerParker parker_;
+};
+
+// Bounded multi-producer/multi-consumer ring (Vyukov). Used where several
+// processing workers pull from one frame queue; with a single producer the
+// push side never retries.
+template <typename T>
+class MpmcRing
+{
+public:
+    explicit MpmcRing(size_t capacity)
+    {
+        size_t rounded = 2;
+        while (rounded < capacity)
+            rounded <<= 1;
+        cells_.reset(new Cell[rounded]);
+        mask_ = rounded - 1;
+        for (size_t i = 0; i < rounded; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(const T &item)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        parker_.notify();
+        return true;
+    }
+
+    bool tryPop(T &item)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        item = cell->item;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename StopPredicate>
+    bool waitPop(T &item, StopPredicate shouldStop, size_t spinIterations = 2000)
+    {
+        return spinThenPark(*this, parker_, item, shouldStop, spinIterations);
+    }
+
+    void wake() { parker_.wakeAll(); }
+
+    // Approximate while producers/consumers are active
+    size_t size() const
+    {
+        const size_t enqueued = enqueuePos_.load(std::memory_order_acquire);
+        const size_t dequeued = dequeuePos_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+    uint64_t overflowCount() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) std::atomic<size_t> dequeuePos_{0};
+    alignas(64) std::atomic<uint64_t> overflows_{0};
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    ConsumerParker parker_;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "CircularBuffer/CircularBuffer.h"
+
+// Fixed set of equally sized frames that a simulated camera cycles through
+class FrameSequence
+{
+public:
+    virtual ~FrameSequence() = default;
+    virtual size_t frameCount() const = 0;
+    virtual const uint8_t *frame(size_t index) const = 0;
+};
+
+// Frames preloaded into a CircularBuffer, index 0 is the most recently pushed one
+class BufferFrameSequence : public FrameSequence
+{
+public:
+    explicit BufferFrameSequence(const CircularBuffer &buffer) : buffer_(buffer) {}
+    size_t frameCount() const override { return buffer_.size(); }
+    const uint8_t *frame(size_t index) const override { return buffer_.getPointer(index); }
+
+private:
+    const CircularBuffer &buffer_;
+};
+
+// Frames owned by the sequence itself, e.g. generated ones
+class MemoryFrameSequence : public FrameSequence
+{
+public:
+    explicit MemoryFrameSequence(size_t frameSize, size_t reserveFrames = 0);
+    void append(const uint8_t *pixels);
+
+    size_t frameCount() const override { return data_.size() / frameSize_; }
+    const uint8_t *frame(size_t index) const override { return data_.data() + index * frameSize_; }
+
+private:
+    size_t frameSize_;
+    std::vector<uint8_t> data_;
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+    void close();
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *file_ = nullptr;
+    void *mapping_ = nullptr;
+#endif
+};
+
+// Frames of a recorded .bin file, served straight from the mapping without decoding.
+// Records are [leading ints][int rows][int cols][int type][pixels]: no leading ints for
+// <condition>_images.bin, one (the batch number) for <condition>_backgrounds.bin.
+// Records whose size differs from the first one are skipped.
+class BinFrameSequence : public FrameSequence
+{
+public:
+    explicit BinFrameSequence(const std::string &path, size_t leadingInts = 0);
+
+    size_t frameCount() const override { return offsets_.size(); }
+    const uint8_t *frame(size_t index) const override { return file_.data() + offsets_[index]; }
+
+    int width() const { return cols_; }
+    int height() const { return rows_; }
+    int type() const { return type_; }
+    size_t frameSize() const { return frameSize_; }
+    size_t skippedRecords() const { return skipped_; }
+
+private:
+    MappedFile file_;
+    std::vector<size_t> offsets_;
+    int rows_ = 0;
+    int cols_ = 0;
+    int type_ = 0;
+    size_t frameSize_ = 0;
+    size_t skipped_ = 0;
+};
+
+// Decoded frames packed back to back behind a fixed header, written once by
+// PackedFrameWriter and mapped by later runs instead of decoding the source images again.
+// The fingerprint identifies the source images the cache was made from.
+class PackedFrameSequence : public FrameSequence
+{
+public:
+    explicit PackedFrameSequence(const std::string &path);
+
+    size_t frameCount() const override { return frameCount_; }
+    const uint8_t *frame(size_t index) const override { return file_.data() + HeaderSize + index * frameSize_; }
+
+    int width() const { return cols_; }
+    int height() const { return rows_; }
+    int type() const { return type_; }
+    size_t frameSize() const { return frameSize_; }
+    uint64_t fingerprint() const { return fingerprint_; }
+
+    static constexpr size_t HeaderSize = 64; // Keeps the frames cache-line aligned in the mapping
+
+private:
+    MappedFile file_;
+    size_t frameCount_ = 0;
+    int rows_ = 0;
+    int cols_ = 0;
+    int type_ = 0;
+    size_t frameSize_ = 0;
+    uint64_t fingerprint_ = 0;
+};
+
+// Writes a PackedFrameSequence file. Frames go to <path>.tmp, which only replaces
+// <path> in finish(), so an interrupted run never leaves a half-written cache behind.
+class PackedFrameWriter
+{
+public:
+    PackedFrameWriter(const std::string &path, int rows, int cols, int type, uint64_t fingerprint);
+    ~PackedFrameWriter();
+    PackedFrameWriter(const PackedFrameWriter &) = delete;
+    PackedFrameWriter &operator=(const PackedFrameWriter &) = delete;
+
+    void append(const uint8_t *pixels);
+    size_t frameCount() const { return frameCount_; }
+    void finish();
+
+private:
+    void writeHeader();
+
+    std::string path_;
+    std::string tempPath_;
+    std::ofstream file_;
+    int rows_;
+    int cols_;
+    int type_;
+    size_t frameSize_;
+    uint64_t fingerprint_;
+    size_t frameCount_ = 0;
+    bool finished_ = false;
+};
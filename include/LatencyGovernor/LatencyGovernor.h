@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sheds optional analysis while processing runs over its latency budget. The p99 of the last
+// window of frame times is checked every window: above the budget one more tier of optional
+// work is shed, below budget * restoreFraction the last tier shed comes back. Gating and
+// triggering never depend on the shed work.
+class LatencyGovernor
+{
+public:
+    // Every tier also sheds the ones before it
+    enum Tier
+    {
+        Full = 0,
+        NoBrightness, // Brightness quantiles of valid cells
+        NoRingStats,  // Ring ratio average/min/max/median only refreshed now and then
+        NoPreviews,   // Valid frame copies for the live preview (kept while recording)
+        NoScatter,    // Scatter plot pushes
+        TierCount
+    };
+
+    // Off until configured with a budget > 0
+    void configure(double budgetUs, size_t window = 256, double restoreFraction = 0.7);
+
+    // Result consumer only, once per analyzed frame
+    void record(double processingUs);
+
+    // Any thread
+    bool enabled() const { return budgetUs_.load(std::memory_order_relaxed) > 0.0; }
+    int tier() const { return tier_.load(std::memory_order_relaxed); }
+    bool sheds(Tier tier) const { return this->tier() >= tier; }
+    double budgetUs() const { return budgetUs_.load(std::memory_order_relaxed); }
+    double p99Us() const { return p99Us_.load(std::memory_order_relaxed); }
+    uint64_t tierChanges() const { return tierChanges_.load(std::memory_order_relaxed); }
+    static const char *tierName(int tier);
+
+private:
+    std::atomic<double> budgetUs_{0.0};
+    std::atomic<int> tier_{Full};
+    std::atomic<double> p99Us_{0.0};
+    std::atomic<uint64_t> tierChanges_{0};
+    double restoreFraction_ = 0.7;
+    std::vector<double> window_; // Frame times since the last decision
+    std::vector<double> sorted_; // nth_element scratch
+    size_t next_ = 0;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CircularBuffer/CircularBuffer.h"
+#include "FramePacer/FramePacer.h"
+#include "FrameSequence/FrameSequence.h"
+#include "FrameQueue/FrameQueue.h"
+#include "image_processing/image_processing.h"
+
+// Event-driven acquisition, independent of the Euresys SDK. Grabber callbacks
+// (real or mock) hand every buffer to a FrameDelivery, which stages it and
+// dispatches it into the processing pipeline.
+
+// Copies the frame into a staging slot and queues the descriptor (frame id and times
+// filled in) for the workers. With every slot still referenced the frame is dropped
+// like a queue overflow instead of overwriting one that is being analyzed.
+bool dispatchStagedFrame(SharedResources &shared, FrameStaging &staging, const uint8_t *pixels,
+                         FrameDescriptor descriptor, bool toDisplay = true);
+
+// Callback threads may call onFrame concurrently; frames are staged and
+// dispatched one at a time so the pipeline still sees a single producer.
+class FrameDelivery
+{
+public:
+    // historyEveryFrame false only copies frames into the history ring while the live view waits for one
+    FrameDelivery(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging &staging,
+                  bool historyEveryFrame = true);
+
+    // Returns false if the frame was not handed on (incomplete, duplicate, paused or shutting down)
+    bool onFrame(const uint8_t *pixels, uint64_t frameId, uint64_t timestamp, bool incomplete);
+
+    uint64_t duplicateCount() const { return duplicates_.load(std::memory_order_relaxed); }
+    uint64_t incompleteCount() const { return incomplete_.load(std::memory_order_relaxed); }
+
+private:
+    SharedResources &shared_;
+    CircularBuffer &historyBuffer_;
+    FrameStaging &staging_;
+    bool historyEveryFrame_;
+    std::mutex mutex_;
+    uint64_t lastFrameId_ = 0;
+    bool hasFrame_ = false;
+    std::atomic<uint64_t> duplicates_{0};
+    std::atomic<uint64_t> incomplete_{0};
+};
+
+struct AcquisitionTelemetry
+{
+    double frameRate = 0.0;
+    double dataRate = 0.0;
+    uint64_t exposureTime = 0;
+};
+
+// Polls camera statistics at low priority so GenICam reads stay off the frame path
+void telemetryThread(SharedResources &shared, std::function<AcquisitionTelemetry()> poll,
+                     std::chrono::milliseconds interval);
+void lowerCurrentThreadPriority();
+
+struct MockBuffer
+{
+    const uint8_t *pixels = nullptr;
+    uint64_t frameId = 0;
+    uint64_t timestamp = 0; // Microseconds
+    bool incomplete = false;
+};
+
+// Stand-in for an EGrabber callback grabber. Replays frames from a sequence at a fixed
+// rate and calls onNewBuffer from one callback thread (like CallbackSingleThread) or
+// several (like CallbackMultiThread). Frames the callbacks cannot keep up with are
+// lost like a DMA overrun and show up as frame id gaps. A frame rate <= 0 free-runs,
+// announcing a frame whenever a callback thread is free instead.
+class MockCallbackGrabber
+{
+public:
+    using Handler = std::function<void(const MockBuffer &)>;
+
+    MockCallbackGrabber(const FrameSequence &frames, size_t imageSize, double frameRate,
+                        size_t callbackThreads, Handler onNewBuffer);
+    ~MockCallbackGrabber();
+
+    // Free-run only: frames are also held back while ready() is false, e.g. to
+    // follow the processing queue instead of overflowing it
+    void setFreeRunGate(std::function<bool()> ready) { freeRunGate_ = std::move(ready); }
+
+    void start();
+    void stop();
+
+    uint64_t framesGenerated() const { return generated_.load(std::memory_order_relaxed); }
+    uint64_t framesLost() const { return lost_.load(std::memory_order_relaxed); }
+    AcquisitionTelemetry telemetry() const;
+    const FramePacer &pacer() const { return pacer_; }
+
+private:
+    void generatorLoop();
+    void callbackLoop();
+
+    const FrameSequence &frames_;
+    size_t imageSize_;
+    size_t callbackThreads_;
+    FramePacer pacer_;
+    Handler onNewBuffer_;
+    std::function<bool()> freeRunGate_;
+
+    MpmcRing<MockBuffer> announced_{256}; // Filled buffers waiting for a callback thread
+    std::atomic<bool> running_{false};
+    std::thread generator_;
+    std::vector<std::thread> callbacks_;
+    std::atomic<uint64_t> generated_{0};
+    std::atomic<uint64_t> lost_{0};
+    std::atomic<double> measuredRate_{0.0};
+};
+
+// Where a sample's frames come from. The pipeline around it (processing workers, display,
+// recording) is the same for every source; run() only has to feed it until shared.done.
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual std::string name() const = 0;
+    virtual const ImageParams &params() const = 0;
+
+    // Prepares shared.backgroundFrame before the pipeline starts
+    virtual void initializeBackground(SharedResources &shared) = 0;
+    // Threads the source needs next to the pipeline, e.g. trigger lines or telemetry
+    virtual void startThreads(SharedResources &shared, std::vector<std::thread> &threads) {}
+    // Produces frames on the calling thread until shared.done. Frames are copied into
+    // staging for the workers, which is null when the source has a framePool of its own
+    virtual void run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging) = 0;
+    // Called once every pipeline thread has been joined
+    virtual void printSummary() const {}
+
+    virtual const FramePacer *pacer() const { return nullptr; }
+    virtual FramePool *framePool() { return nullptr; } // Zero-copy: frames stay in the source's own buffers
+    // Frames stay valid for the whole run (preloaded or mapped), so staging references them instead of copying
+    virtual bool stableFrames() const { return false; }
+    // Per frame index (frame id modulo the frame count), only for generated frames
+    virtual const std::vector<FrameTruth> *groundTruth() const { return nullptr; }
+};
+
+// Simulated camera pacing from config.json: simCameraTargetFPS, or as fast as the workers accept with simCameraFreeRun
+FramePacer makeSimCameraPacer(const json &config);
+void printPacerStats(const FramePacer &pacer);
+
+// Cycles through a frame sequence like a camera, paced by simCameraTargetFPS/simCameraFreeRun
+class SequenceFrameSource : public FrameSource
+{
+public:
+    SequenceFrameSource(MockFrameSet frames, const json &config);
+
+    std::string name() const override { return name_; }
+    const ImageParams &params() const override { return frames_.params; }
+    void initializeBackground(SharedResources &shared) override;
+    void run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging) override;
+    void printSummary() const override { printPacerStats(pacer_); }
+    const FramePacer *pacer() const override { return &pacer_; }
+    bool stableFrames() const override { return true; }
+    const std::vector<FrameTruth> *groundTruth() const override
+    {
+        return frames_.truth.empty() ? nullptr : &frames_.truth;
+    }
+
+protected:
+    MockFrameSet frames_;
+    std::string name_;
+    FramePacer pacer_;
+    bool historyEveryFrame_; // zero_copy_history, as for the zero-copy grabber
+};
+
+// The same frames delivered through a MockCallbackGrabber, for acquisition_mode callback_single/callback_multi
+class MockCallbackFrameSource : public FrameSource
+{
+public:
+    MockCallbackFrameSource(MockFrameSet frames, const json &config);
+
+    std::string name() const override { return "mock callback"; }
+    const ImageParams &params() const override { return frames_.params; }
+    void initializeBackground(SharedResources &shared) override;
+    void startThreads(SharedResources &shared, std::vector<std::thread> &threads) override;
+    void run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging) override;
+    void printSummary() const override;
+    const FramePacer *pacer() const override { return &grabber_.pacer(); }
+    bool stableFrames() const override { return true; }
+    const std::vector<FrameTruth> *groundTruth() const override
+    {
+        return frames_.truth.empty() ? nullptr : &frames_.truth;
+    }
+
+private:
+    MockFrameSet frames_;
+    std::chrono::milliseconds telemetryInterval_;
+    bool historyEveryFrame_;
+    std::unique_ptr<FrameDelivery> delivery_;
+    MockCallbackGrabber grabber_;
+};
+
+// Directory, recorded bin or synthetic frames, delivered the way acquisition_mode asks for
+std::unique_ptr<FrameSource> makeMockFrameSource(MockFrameSet frames, const json &config);
+
+// Generated frames for runs without recorded data: ring-shaped cells on a channel background
+// with a ground-truth label per frame. Cells are placed relative to headlessRoi(), so the
+// labels hold for headless runs. Size, deformation, density, noise and the share of cells
+// crossing the ROI edge come from the synthetic_* keys in config.json.
+MockFrameSet makeSyntheticFrames(const json &config);
+const char *frameTruthName(FrameTruth truth);
+
+// Analysis only runs inside a user-drawn ROI; without a UI it comes from headless_roi
+// [x, y, width, height], defaulting to the frame minus a margin
+cv::Rect headlessRoi(const json &config, const ImageParams &params);
+
+// Gating decisions of a run against the ground truth of its frames
+class GatingScore
+{
+public:
+    explicit GatingScore(const std::vector<FrameTruth> &truth) : truth_(truth) {}
+
+    // Records every analyzed frame of the next run through shared.resultObserver
+    void attach(SharedResources &shared);
+    void record(uint64_t frameId, bool accepted);
+
+    uint64_t count(FrameTruth truth, bool accepted) const { return counts_[static_cast<size_t>(truth)][accepted ? 1 : 0]; }
+    uint64_t total() const;
+    // Share of frames where accepted == (truth == Valid)
+    double accuracy() const;
+    void print() const;
+
+private:
+    const std::vector<FrameTruth> &truth_;
+    uint64_t counts_[4][2] = {};
+};
+
+struct PipelineRunStats
+{
+    double seconds = 0.0;
+    uint64_t acquired = 0;
+    uint64_t analyzed = 0;
+    uint64_t cameraGaps = 0;
+    uint64_t queueOverflows = 0;
+    uint64_t analysisDrops = 0;
+    uint64_t earlyRejects = 0;
+    double meanProcessingUs = 0.0; // Over the last frames kept in shared.processingTimes
+    double p99ProcessingUs = 0.0;
+    double meanTriggerLatencyUs = 0.0; // Handoff to trigger over the last valid frames in shared.triggerLatencies
+    double p99TriggerLatencyUs = 0.0;
+    double handoffLatencyUs = 0.0;
+    double gatingAccuracy = -1.0; // Only for sources with ground truth
+    std::string pipelineKernels;  // Instantiation selectPipelineKernels picked
+    int batchSize = 1;            // Frames per worker wakeup
+    uint64_t contourBufferGrowths = 0; // See contourBufferGrowths(), not an allocation count
+    std::string shedding;          // Optional work the latency governor shed at the end, empty when off
+    uint64_t sheddingChanges = 0;  // Tier changes during the run
+};
+
+// Runs a source through the processing workers only, without display, keyboard or
+// recording threads. Stops after the given time or once maxFrames were acquired (0: no limit).
+// batchSize <= 0 takes processing_batch_size from config.json.
+PipelineRunStats runHeadlessPipeline(FrameSource &source, SharedResources &shared,
+                                     std::chrono::milliseconds duration, uint64_t maxFrames = 0, int batchSize = 0);
@@ -2,6 +2,8 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <vector>
@@ -9,7 +11,13 @@
 #include <opencv2/opencv.hpp>
 #include <chrono>
 #include <nlohmann/json.hpp>
+#include "BackgroundModel/BackgroundModel.h"
 #include "CircularBuffer/CircularBuffer.h"
+#include "FramePool/FramePool.h"
+#include "FramePacer/FramePacer.h"
+#include "FrameSequence/FrameSequence.h"
+#include "FrameQueue/FrameQueue.h"
+#include "LatencyGovernor/LatencyGovernor.h"
 
 #define M_PI 3.14159265358979323846 // pi
 
@@ -40,6 +48,7 @@ struct QualifiedResult
 {
     // ContourResult contourResult;
     int64_t timestamp;
+    uint64_t frameId; // Source frame id (BUFFER_INFO_FRAMEID for the camera)
     double areaRatio;
     double area;
     double deformability;
@@ -49,7 +58,7 @@ struct QualifiedResult
     cv::Mat originalImage;
     cv::Mat processedImage; // Store the binary mask
 
-    QualifiedResult() : timestamp(0), areaRatio(0), area(0), deformability(0), ringRatio(0) {}
+    QualifiedResult() : timestamp(0), frameId(0), areaRatio(0), area(0), deformability(0), ringRatio(0) {}
 };
 
 struct ProcessingConfig
@@ -86,6 +95,59 @@ struct ProcessingConfig
     bool enable_multiple_contours_check;
     bool enable_area_range_check;
     bool require_single_inner_contour; // Require exactly one inner contour
+
+    bool fused_preprocessing = true; // Blur, subtract and threshold in one pass (3x3 and 5x5 blurs)
+    bool packed_morphology = true;   // Close/open on a bit-packed mask
+    bool component_analysis = true;  // Count holes with the run labeler, trace only the gated blob
+
+    // Early reject: frames whose thresholded ROI can't hold a cell skip morphology and contours
+    bool early_reject = true;
+    int reject_min_pixels = 50;   // Fewer foreground pixels after the threshold is an empty frame
+    // More is debris or a lighting jump. -1 follows the area range (five times
+    // area_threshold_max, no limit without the area check), 0 disables the limit.
+    int reject_max_pixels = -1;
+
+    // Multi-object mode: every separate cell in the ROI is measured and recorded on its own
+    bool multi_object = false;
+    int parallel_objects_min = 4; // Cells per frame from which they are measured in parallel
+    int object_crop_margin = 4;   // Pixels kept around a cell's outer contour in its crop
+};
+
+// Foreground of a thresholded ROI, gathered while it is written
+struct ForegroundStats
+{
+    int pixels = 0;
+    cv::Rect bbox; // ROI coordinates, empty without foreground
+};
+
+struct ThreadLocalMats;
+
+// processFrame's hot loops instantiated for fixed settings, chosen by selectPipelineKernels when
+// a snapshot is published. Null members run the generic versions.
+struct PipelineKernels
+{
+    using Threshold = bool (*)(const cv::Mat &image, const cv::Rect &roi, const cv::Mat &blurredBackground,
+                               int threshold, cv::Mat &binary, ThreadLocalMats &mats, ForegroundStats *foreground);
+    using CloseOpen = bool (*)(const cv::Mat &binary, const cv::Rect &roi, cv::Mat &output, ThreadLocalMats &mats);
+
+    // GaussianBlur, subtract and threshold of the ROI in one row-streamed pass, bit-identical to
+    // the separate calls (see verifyPipelineKernels). foreground, if given, receives the stats
+    // of the written mask. Only set for 3x3 and 5x5 blurs.
+    Threshold threshold = nullptr;
+    CloseOpen closeOpen = nullptr; // Packed close/open for the cross kernel size and iterations
+    std::string name;
+};
+
+// Everything processFrame reads from SharedResources, frozen when it is published. Workers
+// swap to a new version between frames without taking a lock.
+struct PipelineSnapshot
+{
+    uint64_t version = 0;
+    ProcessingConfig config;
+    cv::Rect roi;
+    cv::Mat blurredBackground; // Own copy, writers blur into the shared one in place
+    cv::Mat kernel;            // Morphology kernel for config.morph_kernel_size
+    PipelineKernels kernels;
 };
 
 struct ThreadLocalMats
@@ -97,7 +159,14 @@ struct ThreadLocalMats
     cv::Mat dilate1;
     cv::Mat erode1;
     cv::Mat erode2;
-    cv::Mat kernel;
+    std::shared_ptr<const PipelineSnapshot> snapshot; // Settings of the last processFrame call
+    std::vector<uint8_t> paddedRow; // Scratch rows of PipelineKernels::threshold
+    std::vector<uint16_t> blurRows;
+    std::vector<uint64_t> morphWords; // Two bit planes of packedCloseOpen
+    const uint8_t *outputData = nullptr; // Output buffer of the last processFrame call, zero outside roi
+    bool outputClear = false;            // Its roi is all zero too
+    bool emptyFrame = false;             // The early reject found less than reject_min_pixels of foreground
+    cv::Rect roi;
     bool initialized = false;
 };
 
@@ -115,6 +184,109 @@ struct FilterResult
     BrightnessQuantiles brightness; // Brightness distribution in the masked area
 };
 
+// One cell of a multi-object frame
+struct ObjectResult
+{
+    FilterResult result;
+    cv::Rect box;           // Crop, frame coordinates
+    cv::Rect cellBox;       // The cell's outer contour without the crop margin, for its brightness
+    cv::Mat originalImage;  // Crops, cloned by the worker
+    cv::Mat processedImage;
+};
+
+// Scratch of the contour analysis, one per thread (threadContourWorkspace) and reused from frame
+// to frame, so its buffers only grow for frames busier than the ones before. Contours are
+// referred to by index.
+struct ContourWorkspace
+{
+    std::vector<std::vector<cv::Point>> contours; // As traced
+    std::vector<cv::Vec4i> hierarchy;
+    std::vector<int> kept;    // Contours above the noise area
+    std::vector<int> inner;   // Kept contours with a parent
+    std::vector<int> parents; // Per inner contour: its parent's position in kept, -1 if unknown
+    std::vector<cv::Point> sorted; // Hull scratch
+    std::vector<cv::Point> hull;
+    std::vector<int> candidates;        // analyzeObjects: blobs with a hole, one per cell
+    std::vector<ObjectResult> measured; // analyzeObjects: per candidate
+    cv::Mat mask;                  // Blob rendering for ComponentLabeler::traceBlob
+    size_t footprint = 0;          // Bytes held after the last settleContourWorkspace
+};
+
+struct HullMetrics
+{
+    double area = 0.0;
+    double perimeter = 0.0;
+};
+
+// Outcome of one dispatched frame as produced by a processing worker
+struct FrameResult
+{
+    uint64_t sequence = 0;
+    uint64_t frameId = 0;
+    bool analyzed = false; // False when the worker skipped the frame to catch up
+    FilterResult filterResult{};
+    double processingTimeUs = 0.0;
+    double triggerLatencyUs = -1.0; // Frame handoff to trigger raised, valid frames only
+    uint64_t snapshotVersion = 0; // PipelineSnapshot the frame was analyzed with
+    cv::Mat originalImage; // Only filled for valid frames
+    cv::Mat processedImage;
+    std::vector<ObjectResult> objects; // Multi-object mode: the valid cells, each recorded on its own
+};
+
+// Puts results from several processing workers back into dispatch order.
+// Whichever worker completes the oldest outstanding frame emits every result
+// that is ready, outside the lock, so consumers still see one frame at a time.
+class ResultSequencer
+{
+public:
+    using Consumer = std::function<void(FrameResult &)>;
+
+    // window must exceed the number of frames that can be in flight at once
+    explicit ResultSequencer(size_t window);
+
+    void reset(uint64_t firstSequence, Consumer consumer);
+    void submit(FrameResult &&result);
+    // Moves every result out of results under a single lock
+    void submit(std::vector<FrameResult> &results);
+    size_t pendingCount() const;
+
+private:
+    void emit();
+
+    mutable std::mutex mutex_;
+    std::vector<FrameResult> window_;
+    std::vector<char> ready_;
+    uint64_t next_ = 0;
+    size_t pending_ = 0;
+    bool emitting_ = false;
+    Consumer consumer_;
+    std::vector<FrameResult> batch_; // Only touched by the emitting worker, keeps its capacity
+};
+
+// Hands the live view frames the workers have already analyzed, so it does not run the pipeline
+// a second time. Holds one pending entry: workers only copy a frame in once the display has
+// taken the previous one, which keeps the copies at the display rate.
+class DisplayResults
+{
+public:
+    // Workers. Copies the frame, its mask and result if the display is waiting for one, otherwise
+    // returns false right away. An empty mask stands for a frame that was not segmented.
+    bool offer(uint64_t frameId, const cv::Mat &originalImage, const cv::Mat &processedImage,
+               const FilterResult &result);
+
+    // Display thread. Swaps the newest offered entry into the given buffers, false if there is
+    // none since the last call.
+    bool take(uint64_t &frameId, cv::Mat &originalImage, cv::Mat &processedImage, FilterResult &result);
+
+private:
+    std::mutex mutex_;
+    std::atomic<bool> hasPending_{false}; // Read unlocked first, so workers skip the mutex while the display is behind
+    uint64_t frameId_ = 0;
+    cv::Mat originalImage_;
+    cv::Mat processedImage_;
+    FilterResult result_{};
+};
+
 struct SharedResources
 {
 
@@ -148,6 +320,7 @@ struct SharedResources
         cv::Mat processedImage;
         FilterResult result;
         size_t frameIndex;
+        uint64_t frameId;
         int64_t timestamp;
     };
     std::deque<ValidFrameData> validFramesQueue;
@@ -157,12 +330,37 @@ struct SharedResources
 
     std::atomic<size_t> latestCameraFrame{0}; // for simulated camera
     std::atomic<size_t> frameRateCount{0};    // for simulated camera
-    std::queue<size_t> framesToProcess;
-    std::queue<size_t> framesToDisplay;
-    std::mutex displayQueueMutex;
-    std::mutex processingQueueMutex;
-    std::condition_variable displayQueueCondition;
-    std::condition_variable processingQueueCondition;
+    // Acquisition -> consumer handoff; descriptor slots are framePool slots
+    MpmcRing<FrameDescriptor> processingRing{1024}; // Shared by all processing workers
+    SpscRing<FrameDescriptor> displayRing{1024};
+    uint64_t nextDispatchSequence = 0;              // Producer only, see dispatchFrame
+    ResultSequencer resultSequencer{4096};          // Must cover processingRing plus frames held by workers
+    DisplayResults displayResults;                  // Analyzed frames for the live view
+    std::atomic<int> processingWorkers{1};
+    std::atomic<int> processingBatchSize{1};    // Frames a worker takes from the queue per wakeup
+    std::atomic<bool> processEveryFrame{false}; // Strict mode: workers never skip frames to catch up
+    // Optional, sees every analyzed frame in frame order (set before the workers start)
+    std::function<void(const FrameResult &)> resultObserver;
+
+    // Frame accounting. Every acquired frame ends up analyzed, dropped for a full
+    // queue or skipped by analysis: acquired = analyzed + overflows + drops + in flight
+    struct FrameAccounting
+    {
+        std::atomic<uint64_t> acquired{0};
+        std::atomic<uint64_t> analyzed{0};
+        std::atomic<uint64_t> cameraGaps{0};     // Frame ids the source never delivered (jumps, incomplete frames)
+        std::atomic<uint64_t> queueOverflows{0}; // Processing ring or frame pool full
+        std::atomic<uint64_t> analysisDrops{0};  // Skipped by workers to stay on the newest frame
+        std::atomic<uint64_t> earlyRejects{0};   // Analyzed, but rejected before morphology
+    } frameAccounting;
+    uint64_t lastAcquiredFrameId = 0; // Producer only
+    bool hasAcquiredFrame = false;    // Producer only
+    std::atomic<int64_t> handoffLatencyNs{0}; // Push-to-pop latency of the processing ring (moving average)
+    FramePool *framePool{nullptr};            // Grabber buffers (zero-copy) or the staging copies the workers read
+    const FramePacer *framePacer{nullptr};    // Simulated camera pacing, for the dashboard
+    std::atomic<size_t> framePoolExhausted{0}; // Frames dropped unprocessed because every slot was still referenced
+    std::unique_ptr<BackgroundModel> backgroundModel; // Fed with empty frames by the workers, null when disabled
+    LatencyGovernor latencyGovernor;                  // Optional work shed while processing runs over budget
     // std::vector<std::tuple<double, double>> deformabilities;
     // std::mutex deformabilitiesMutex;
     std::atomic<bool> newScatterDataAvailable{false};
@@ -189,6 +387,7 @@ struct SharedResources
     std::string saveDirectory;
     // metrics
     CircularBuffer processingTimes{1000, sizeof(double)};                          // Buffer to store last 1000 processing times
+    CircularBuffer triggerLatencies{1000, sizeof(double)};                         // Handoff to trigger of the last 1000 valid frames
     CircularBuffer deformabilityBuffer{10000, sizeof(std::tuple<double, double>)}; // Buffer for last 1000 deformability measurements
     std::mutex deformabilityBufferMutex;
     std::atomic<double> currentFPS;
@@ -204,7 +403,6 @@ struct SharedResources
     std::atomic<double> currentVoltage{0.0}; // Current voltage for autofocus control
     // std::atomic<size_t> totalFramesProcessed;
     std::atomic<bool> updated;
-    std::atomic<bool> validProcessingFrame{false};
     std::atomic<bool> validDisplayFrame{false};
     std::atomic<bool> displayFrameTouchedBorder{false};
     std::atomic<bool> hasSingleInnerContour{false};
@@ -215,6 +413,11 @@ struct SharedResources
 
     ProcessingConfig processingConfig;
     std::mutex processingConfigMutex;
+    // processingConfig, roi and blurredBackground as the processing path sees them. Whoever
+    // changes those calls publishPipelineSnapshot afterwards. Only accessed through
+    // std::atomic_load/atomic_store, pipelineVersion is stored last.
+    std::shared_ptr<const PipelineSnapshot> pipelineSnapshot;
+    std::atomic<uint64_t> pipelineVersion{0};
     std::atomic<bool> processTrigger{false};
     std::atomic<bool> manualTriggerEnabled{false}; // Toggle for manual trigger mode
 
@@ -243,12 +446,64 @@ struct SharedResources
 // Function declarations
 ImageParams initializeImageParams(const std::string &directory);
 void loadImages(const std::string &directory, CircularBuffer &cameraBuffer, bool reverseOrder = false);
-void initializeMockBackgroundFrame(SharedResources &shared, const ImageParams &params, const CircularBuffer &cameraBuffer);
-void processFrame(const cv::Mat &inputImage, SharedResources &shared,
+void initializeMockBackgroundFrame(SharedResources &shared, const ImageParams &params, const FrameSequence &frames);
+
+// What an ideal gate decides for a generated frame
+enum class FrameTruth : uint8_t
+{
+    Empty,   // No cell in the ROI
+    Valid,   // Exactly one cell, fully inside the ROI
+    Doublet, // Several cells inside the ROI
+    Border   // A cell crosses the ROI edge
+};
+
+// Frames for the simulated camera. A folder holding a recorded <condition>_images.bin is
+// replayed from a memory mapping; otherwise its loose images are decoded in parallel into a
+// packed cache next to them (image_cache), or into cameraBuffer if the cache can't be written.
+struct MockFrameSet
+{
+    std::string origin; // "directory", "bin replay" or "synthetic"
+    ImageParams params;
+    std::unique_ptr<CircularBuffer> cameraBuffer;
+    std::unique_ptr<FrameSequence> frames;
+    std::unique_ptr<FrameSequence> backgrounds; // Recorded backgrounds of a replay, may be null
+    std::vector<FrameTruth> truth;              // One per frame for synthetic frames, empty otherwise
+};
+MockFrameSet openMockFrames(const std::string &directory);
+void initializeMockBackgroundFrame(SharedResources &shared, const MockFrameSet &mock);
+// Freezes the current processingConfig, roi and blurredBackground into a new snapshot
+void publishPipelineSnapshot(SharedResources &shared);
+std::shared_ptr<const PipelineSnapshot> loadPipelineSnapshot(const SharedResources &shared);
+// Swaps mats.snapshot to the latest version if one was published since the last call
+const PipelineSnapshot &refreshPipelineSnapshot(SharedResources &shared, ThreadLocalMats &mats);
+// Returns false if the early reject found no plausible cell, the ROI of outputImage is then empty
+bool processFrame(const cv::Mat &inputImage, SharedResources &shared,
                   cv::Mat &outputImage, ThreadLocalMats &mats);
-std::tuple<std::vector<std::vector<cv::Point>>, bool, std::vector<std::vector<cv::Point>>, std::vector<int>> findContours(const cv::Mat &processedImage);
+void countForeground(const cv::Mat &binary, const cv::Rect &roi, ForegroundStats &foreground);
+PipelineKernels selectPipelineKernels(const ProcessingConfig &config);
+// Runs the kernels selectPipelineKernels picks against the OpenCV calls they replace, on random
+// frames and ROIs. Prints every case that differs and returns their count.
+int verifyPipelineKernels(unsigned seed = 1);
+// MORPH_CLOSE then MORPH_OPEN of the ROI on a mask packed 64 pixels per word. The ROI is
+// morphed on its own: pixels outside it never influence the result. Returns false for
+// kernels whose rows are not single runs (cross, rect and ellipse all are).
+bool packedCloseOpen(const cv::Mat &binary, const cv::Rect &roi, const cv::Mat &kernel, int iterations,
+                     cv::Mat &output, ThreadLocalMats &mats);
+std::tuple<std::vector<std::vector<cv::Point>>, bool, std::vector<std::vector<cv::Point>>, std::vector<int>> findContours(const cv::Mat &processedImage, const cv::Point &offset = cv::Point());
+// Same filtering into ws.contours/kept/inner/parents, reusing their buffers from frame to frame
+void findContours(const cv::Mat &processedImage, const cv::Point &offset, ContourWorkspace &ws);
 std::tuple<double, double> calculateMetrics(const std::vector<cv::Point> &contour);
 
+ContourWorkspace &threadContourWorkspace();
+// Call once a frame is done with ws. Counts a growth if its buffers hold more than after the last call.
+void settleContourWorkspace(ContourWorkspace &ws);
+// Contour buffer growths of all threads since startup: how often a ContourWorkspace buffer had
+// to grow. It stops rising once the buffers fit the frames. This is not an allocation count,
+// cv::findContours and the brightness quantiles still allocate internally.
+uint64_t contourBufferGrowths();
+// Convex hull of points into ws.hull, with the hull's area and closed perimeter
+HullMetrics convexHullMetrics(const std::vector<cv::Point> &points, ContourWorkspace &ws);
+
 void onTrackbar(int pos, void *userdata);
 // void updateScatterPlot(cv::Mat &plot, const std::vector<std::tuple<double, double>> &circularities);
 
@@ -265,26 +520,46 @@ bool updateConfig(const std::string &filename, const std::string &key, const jso
 
 void updateBackgroundWithCurrentSettings(SharedResources &shared);
 
-void temp_mockSample(const ImageParams &params, CircularBuffer &cameraBuffer, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared);
-
-void simulateCameraThread(CircularBuffer &cameraBuffer, SharedResources &shared, const ImageParams &params);
+bool dispatchFrame(SharedResources &shared, const FrameDescriptor &frame, bool toDisplay = true);
+void wakeFrameConsumers(SharedResources &shared);
+void accountDroppedFrame(SharedResources &shared, uint64_t frameId);
+void resetFrameAccounting(SharedResources &shared);
+void saveFrameAccounting(const SharedResources &shared, const std::string &directory);
+// Most frames the processing ring and the workers can hold at once, what a frame pool
+// has to cover so dispatch never runs out of slots while the queue has room
+size_t processingFramesInFlight(const SharedResources &shared, const json &config, int batchSize = 0);
+// Workers read frames through shared.framePool, which must be set before the first dispatch.
+// batchSize <= 0 takes processing_batch_size from config.json
+void startProcessingWorkers(SharedResources &shared, const ImageParams &params, std::vector<std::thread> &threads,
+                            int batchSize = 0);
 void setupCommonThreads(SharedResources &shared, const std::string &saveDir,
-                        const CircularBuffer &circularBuffer, const CircularBuffer &processingBuffer, const ImageParams &params,
+                        const CircularBuffer &circularBuffer, const ImageParams &params,
                         std::vector<std::thread> &threads);
 void commonSampleLogic(SharedResources &shared, const std::string &SAVE_DIRECTORY,
                        std::function<std::vector<std::thread>(SharedResources &, const std::string &)> setupThreads);
+class FrameSource;
+void runFrameSource(FrameSource &source, SharedResources &shared);
 
 void validFramesDisplayThread(SharedResources &shared, const CircularBuffer &circularBuffer, const ImageParams &imageParams);
 
 ThreadLocalMats initializeThreadMats(int height, int width, SharedResources &shared);
 
-void reviewSavedData();
+void reviewSavedData(const std::string &projectPath);
 
 void calculateMetricsFromSavedData(const std::string &inputDirectory, const std::string &outputFilePath);
 
+// Gating and shape metrics of the frame. Brightness quantiles are only computed when the
+// original image is given; objectBox receives the measured object's box so they can be
+// computed later instead.
 FilterResult filterProcessedImage(const cv::Mat &processedImage, const cv::Rect &roi,
                                   const ProcessingConfig &config, const uint8_t processedColor = 255,
-                                  const cv::Mat &originalImage = cv::Mat());
+                                  const cv::Mat &originalImage = cv::Mat(), cv::Rect *objectBox = nullptr);
+
+// Multi-object mode: measures every ring-shaped blob in the ROI on its own. objects receives the
+// valid ones, the returned frame result reads like the first of them. Without the original image
+// brightness quantiles are left for the caller, see ObjectResult::cellBox.
+FilterResult analyzeObjects(const cv::Mat &processedImage, const cv::Rect &roi, const ProcessingConfig &config,
+                            const cv::Mat &originalImage, std::vector<ObjectResult> &objects);
 
 FilterResult legacyContourAnalysis(const cv::Mat &processedImage, const cv::Rect &roi, const ProcessingConfig &config);
 
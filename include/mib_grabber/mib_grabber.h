@@ -17,8 +17,6 @@ struct GrabberParams
 void configure_js(std::string config_path);
 GrabberParams initializeGrabber(Euresys::EGrabber<Euresys::CallbackOnDemand> &grabber);
 void initializeBackgroundFrame(SharedResources &shared, const ImageParams &params);
-void temp_sample(Euresys::EGrabber<Euresys::CallbackOnDemand> &grabber, const ImageParams &params, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared);
-void hybrid_sample(Euresys::EGrabber<Euresys::CallbackOnDemand> &grabber, const ImageParams &params, CircularBuffer &cameraBuffer, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared);
 void runHybridSample();
 int mib_grabber_main();
 int selectCamera();
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "BackgroundModel/BackgroundModel.h"
+
+namespace
+{
+    int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+}
+
+BackgroundModel::BackgroundModel(std::chrono::milliseconds sampleInterval)
+    : intervalNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(sampleInterval).count())
+{
+}
+
+void BackgroundModel::seed(const cv::Mat &background)
+{
+    CV_Assert(background.type() == CV_8UC1);
+    background.copyTo(estimate_);
+    samples_ = 0;
+}
+
+bool BackgroundModel::offer(const cv::Mat &frame)
+{
+    const int64_t now = nowNs();
+    if (now < nextSampleNs_.load(std::memory_order_relaxed))
+        return false;
+
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || hasPending_)
+        return false;
+    frame.copyTo(pending_);
+    hasPending_ = true;
+    nextSampleNs_.store(now + intervalNs_, std::memory_order_relaxed);
+    lock.unlock();
+    offered_.notify_one();
+    return true;
+}
+
+bool BackgroundModel::update(std::chrono::milliseconds timeout)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!offered_.wait_for(lock, timeout, [this]()
+                               { return hasPending_; }))
+            return false;
+        std::swap(pending_, sample_);
+        hasPending_ = false;
+    }
+
+    if (estimate_.size() != sample_.size() || estimate_.type() != sample_.type())
+    {
+        seed(sample_);
+    }
+    else
+    {
+        for (int y = 0; y < sample_.rows; y++)
+        {
+            const uint8_t *in = sample_.ptr<uint8_t>(y);
+            uint8_t *out = estimate_.ptr<uint8_t>(y);
+            for (int x = 0; x < sample_.cols; x++)
+            {
+                out[x] = static_cast<uint8_t>(out[x] + (in[x] > out[x]) - (in[x] < out[x]));
+            }
+        }
+    }
+    samples_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
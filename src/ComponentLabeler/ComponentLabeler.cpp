@@ -0,0 +1,206 @@
+#include "ComponentLabeler/ComponentLabeler.h"
+#include <algorithm>
+#include <cstring>
+
+int ComponentLabeler::find(int run)
+{
+    while (runs_[run].parent != run)
+    {
+        runs_[run].parent = runs_[runs_[run].parent].parent; // Path halving
+        run = runs_[run].parent;
+    }
+    return run;
+}
+
+// The smaller index wins, so a root is always the first run of its component in raster order
+void ComponentLabeler::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a < b)
+        runs_[b].parent = a;
+    else if (b < a)
+        runs_[a].parent = b;
+}
+
+int ComponentLabeler::runCovering(int y, int x) const
+{
+    const auto first = runs_.begin() + rowStart_[y];
+    const auto last = runs_.begin() + rowStart_[y + 1];
+    const auto it = std::upper_bound(first, last, x, [](int value, const Run &run)
+                                     { return value < run.x0; });
+    return static_cast<int>(it - runs_.begin()) - 1;
+}
+
+void ComponentLabeler::label(const cv::Mat &mask)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+    const int width = mask.cols;
+    const int height = mask.rows;
+    runs_.clear();
+    blobs_.clear();
+    holes_.clear();
+    rowStart_.assign(static_cast<size_t>(height) + 1, 0);
+
+    for (int y = 0; y < height; y++)
+    {
+        rowStart_[y] = static_cast<int>(runs_.size());
+        const uint8_t *row = mask.ptr<uint8_t>(y);
+        int x = 0;
+        while (x < width)
+        {
+            const bool foreground = row[x] != 0;
+            const int start = x;
+            if (!foreground)
+            {
+                // Background dominates, skip it eight pixels at a time
+                uint64_t word;
+                while (x + 8 <= width && (std::memcpy(&word, row + x, sizeof(word)), word == 0))
+                    x += 8;
+            }
+            while (x < width && (row[x] != 0) == foreground)
+                x++;
+            const int index = static_cast<int>(runs_.size());
+            runs_.push_back({y, start, x - 1, index, foreground});
+        }
+
+        if (y == 0)
+            continue;
+
+        // Join with the previous row: foreground touching diagonally (8-connected),
+        // background only through shared columns (4-connected)
+        int above = rowStart_[y - 1];
+        const int aboveEnd = rowStart_[y];
+        for (int current = rowStart_[y]; current < static_cast<int>(runs_.size()); current++)
+        {
+            const Run run = runs_[current];
+            const int reach = run.foreground ? 1 : 0;
+            while (above < aboveEnd && runs_[above].x1 < run.x0 - reach)
+                above++;
+            for (int k = above; k < aboveEnd && runs_[k].x0 <= run.x1 + reach; k++)
+            {
+                if (runs_[k].foreground == run.foreground)
+                    unite(current, k);
+            }
+        }
+    }
+    rowStart_[height] = static_cast<int>(runs_.size());
+
+    // Background reaching the mask edge is outside every blob
+    exterior_.assign(runs_.size(), 0);
+    for (int i = 0; i < static_cast<int>(runs_.size()); i++)
+    {
+        const Run &run = runs_[i];
+        if (!run.foreground && (run.y == 0 || run.y == height - 1 || run.x0 == 0 || run.x1 == width - 1))
+            exterior_[find(i)] = 1;
+    }
+
+    // Roots come first in raster order, so whatever lies directly above a component's first
+    // pixel (background for a blob, foreground for a hole) already has its index. That pixel
+    // belongs to the region enclosing the component.
+    component_.assign(runs_.size(), -1);
+    for (int i = 0; i < static_cast<int>(runs_.size()); i++)
+    {
+        const Run &run = runs_[i];
+        const int root = find(i);
+        if (root == i)
+        {
+            const int above = run.y > 0 ? runCovering(run.y - 1, run.x0) : -1;
+            const int enclosing = above >= 0 ? component_[above] : -1;
+            if (run.foreground)
+            {
+                component_[i] = static_cast<int>(blobs_.size());
+                Blob blob;
+                blob.parentHole = enclosing;
+                blob.bbox = cv::Rect(run.x0, run.y, 0, 0);
+                blobs_.push_back(blob);
+            }
+            else if (!exterior_[i])
+            {
+                component_[i] = static_cast<int>(holes_.size());
+                Hole hole;
+                hole.owner = enclosing;
+                hole.bbox = cv::Rect(run.x0, run.y, 0, 0);
+                holes_.push_back(hole);
+            }
+        }
+        else
+        {
+            component_[i] = component_[root];
+        }
+
+        if (component_[i] < 0)
+            continue;
+
+        const int length = run.x1 - run.x0 + 1;
+        const cv::Rect extent(run.x0, run.y, length, 1);
+        if (run.foreground)
+        {
+            Blob &blob = blobs_[component_[i]];
+            blob.bbox = blob.area ? (blob.bbox | extent) : extent;
+            blob.area += length;
+            blob.sumX += 0.5 * length * (run.x0 + run.x1);
+            blob.sumY += static_cast<double>(length) * run.y;
+        }
+        else
+        {
+            Hole &hole = holes_[component_[i]];
+            hole.bbox = hole.area ? (hole.bbox | extent) : extent;
+            hole.area += length;
+        }
+    }
+
+    for (const Hole &hole : holes_)
+    {
+        if (hole.owner < 0)
+            continue;
+        Blob &blob = blobs_[hole.owner];
+        blob.smallestHole = blob.holeCount ? std::min(blob.smallestHole, hole.area) : hole.area;
+        blob.holeCount++;
+        blob.holeArea += hole.area;
+    }
+}
+
+void ComponentLabeler::renderBlob(int blob, cv::Mat &mask) const
+{
+    const cv::Rect &bbox = blobs_[blob].bbox;
+    mask.create(bbox.height, bbox.width, CV_8UC1);
+    drawBlob(blob, mask);
+}
+
+void ComponentLabeler::drawBlob(int blob, cv::Mat &mask) const
+{
+    const cv::Rect &bbox = blobs_[blob].bbox;
+    mask.setTo(cv::Scalar(0));
+    for (int y = bbox.y; y < bbox.y + bbox.height; y++)
+    {
+        uint8_t *row = mask.ptr<uint8_t>(y - bbox.y);
+        for (int i = rowStart_[y]; i < rowStart_[y + 1]; i++)
+        {
+            const Run &run = runs_[i];
+            if (run.foreground && component_[i] == blob)
+                std::memset(row + (run.x0 - bbox.x), 255, static_cast<size_t>(run.x1 - run.x0 + 1));
+        }
+    }
+}
+
+void ComponentLabeler::traceBlob(int blob, const cv::Point &offset, std::vector<std::vector<cv::Point>> &contours,
+                                 std::vector<cv::Vec4i> &hierarchy) const
+{
+    traceBlob(blob, offset, contours, hierarchy, scratch_);
+}
+
+void ComponentLabeler::traceBlob(int blob, const cv::Point &offset, std::vector<std::vector<cv::Point>> &contours,
+                                 std::vector<cv::Vec4i> &hierarchy, cv::Mat &mask) const
+{
+    // The mask only ever grows, the blob is drawn into its top left corner
+    const cv::Rect &bbox = blobs_[blob].bbox;
+    if (mask.type() != CV_8UC1 || mask.rows < bbox.height || mask.cols < bbox.width)
+    {
+        mask.create(std::max(mask.rows, bbox.height), std::max(mask.cols, bbox.width), CV_8UC1);
+    }
+    cv::Mat view = mask(cv::Rect(0, 0, bbox.width, bbox.height));
+    drawBlob(blob, view);
+    cv::findContours(view, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE,
+                     offset + bbox.tl());
+}
@@ -0,0 +1,131 @@
+#include "FramePacer/FramePacer.h"
+#include <thread>
+
+namespace
+{
+    // Upper edges of the achieved/target ratio bins, the last bin takes everything above
+    const double binEdges[FramePacer::HistogramBins - 1] = {0.5, 0.9, 0.99, 1.01, 1.1, 1.5, 2.0};
+    const char *binLabels[FramePacer::HistogramBins] = {"<0.5", "0.5-0.9", "0.9-0.99", "0.99-1.01",
+                                                        "1.01-1.1", "1.1-1.5", "1.5-2", ">2"};
+}
+
+FramePacer::FramePacer(double frameRate, std::chrono::microseconds spinWindow, size_t maxBurst)
+    : targetNs_(frameRate > 0 ? static_cast<int64_t>(1e9 / frameRate) : 0),
+      spinNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(spinWindow).count()),
+      maxBurst_(maxBurst > 0 ? maxBurst : 1)
+{
+    reset();
+}
+
+void FramePacer::reset()
+{
+    next_ = clock::now();
+    last_ = next_;
+    started_ = false;
+}
+
+size_t FramePacer::waitNext()
+{
+    if (freeRun())
+    {
+        markFrame();
+        return 1;
+    }
+
+    if (!started_)
+    {
+        // The first frame goes out immediately
+        started_ = true;
+        next_ = clock::now() + std::chrono::nanoseconds(targetNs_);
+        last_ = clock::now();
+        return 1;
+    }
+
+    auto now = clock::now();
+    if (now < next_)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(next_ - now).count();
+        if (remaining > spinNs_)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - spinNs_));
+        }
+        while ((now = clock::now()) < next_)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Every deadline that passed while we slept is due now
+    const int64_t lateNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - next_).count();
+    size_t due = 1 + static_cast<size_t>(lateNs / targetNs_);
+    if (due > maxBurst_)
+    {
+        // Stalled for too long, give up on catching up like a camera that lost those frames
+        due = maxBurst_;
+        next_ = now;
+    }
+    next_ += std::chrono::nanoseconds(targetNs_ * static_cast<int64_t>(due));
+
+    record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count(), due);
+    last_ = now;
+    return due;
+}
+
+void FramePacer::markFrame()
+{
+    auto now = clock::now();
+    if (started_)
+    {
+        record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count(), 1);
+    }
+    started_ = true;
+    last_ = now;
+}
+
+void FramePacer::record(int64_t intervalNs, uint64_t frames)
+{
+    frames_.fetch_add(frames, std::memory_order_relaxed);
+    totalNs_.fetch_add(static_cast<uint64_t>(intervalNs), std::memory_order_relaxed);
+    if (static_cast<uint64_t>(intervalNs) > maxNs_.load(std::memory_order_relaxed))
+    {
+        maxNs_.store(static_cast<uint64_t>(intervalNs), std::memory_order_relaxed);
+    }
+
+    if (freeRun())
+        return;
+
+    // A burst hands out one frame after the full wait and the rest back to back
+    const double ratio = static_cast<double>(intervalNs) / static_cast<double>(targetNs_);
+    size_t bin = 0;
+    while (bin < HistogramBins - 1 && ratio >= binEdges[bin])
+    {
+        bin++;
+    }
+    histogram_[bin].fetch_add(1, std::memory_order_relaxed);
+    if (frames > 1)
+    {
+        histogram_[0].fetch_add(frames - 1, std::memory_order_relaxed);
+    }
+}
+
+FramePacer::Stats FramePacer::stats() const
+{
+    Stats stats;
+    stats.targetIntervalUs = targetNs_ / 1000.0;
+    stats.frames = frames_.load(std::memory_order_relaxed);
+    if (stats.frames > 0)
+    {
+        stats.meanIntervalUs = totalNs_.load(std::memory_order_relaxed) / 1000.0 / stats.frames;
+    }
+    stats.maxIntervalUs = maxNs_.load(std::memory_order_relaxed) / 1000.0;
+    for (size_t i = 0; i < HistogramBins; i++)
+    {
+        stats.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+const char *FramePacer::binLabel(size_t bin)
+{
+    return bin < HistogramBins ? binLabels[bin] : "";
+}
@@ -0,0 +1,147 @@
+#include "FramePool/FramePool.h"
+#include <cstring>
+
+FramePool::FramePool(size_t slotCount)
+    : slotCount_(slotCount), slots_(new Slot[slotCount])
+{
+    if (slotCount == 0)
+        throw std::invalid_argument("FramePool needs at least one slot");
+
+    freeSlots_.reserve(slotCount);
+    // Hand out low slot numbers first
+    for (size_t i = slotCount; i > 0; i--)
+    {
+        freeSlots_.push_back(i - 1);
+    }
+    freeCount_.store(slotCount);
+    minFreeCount_.store(slotCount);
+}
+
+bool FramePool::acquire(size_t &slot)
+{
+    if (freeSlots_.empty())
+        return false;
+
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+
+    size_t freeNow = freeSlots_.size();
+    freeCount_.store(freeNow, std::memory_order_relaxed);
+    if (freeNow < minFreeCount_.load(std::memory_order_relaxed))
+    {
+        minFreeCount_.store(freeNow, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void FramePool::publish(size_t slot, const uint8_t *data, uint64_t frameId, uint64_t timestamp)
+{
+    Slot &s = slots_[slot];
+    s.data = data;
+    s.frameId = frameId;
+    s.timestamp = timestamp;
+    // The reference created here belongs to whoever adopts the slot
+    s.refs.store(1, std::memory_order_release);
+}
+
+FrameHandle FramePool::adopt(size_t slot)
+{
+    if (slot >= slotCount_)
+        throw std::out_of_range("Frame slot out of range");
+    return FrameHandle(this, slot);
+}
+
+FrameHandle FramePool::get(size_t slot)
+{
+    if (slot >= slotCount_)
+        throw std::out_of_range("Frame slot out of range");
+    retain(slot);
+    return FrameHandle(this, slot);
+}
+
+void FramePool::retain(size_t slot)
+{
+    slots_[slot].refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FramePool::release(size_t slot)
+{
+    if (slots_[slot].refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        pendingReleases_.fetch_add(1, std::memory_order_relaxed);
+        slots_[slot].released.store(true, std::memory_order_release);
+    }
+}
+
+FrameHandle::FrameHandle(const FrameHandle &other) : pool_(other.pool_), slot_(other.slot_)
+{
+    if (pool_)
+        pool_->retain(slot_);
+}
+
+FrameHandle::FrameHandle(FrameHandle &&other) noexcept : pool_(other.pool_), slot_(other.slot_)
+{
+    other.pool_ = nullptr;
+}
+
+FrameHandle &FrameHandle::operator=(const FrameHandle &other)
+{
+    if (this != &other)
+    {
+        if (other.pool_)
+            other.pool_->retain(other.slot_);
+        reset();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+    }
+    return *this;
+}
+
+FrameHandle &FrameHandle::operator=(FrameHandle &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+FrameHandle::~FrameHandle() { reset(); }
+
+void FrameHandle::reset()
+{
+    if (pool_)
+    {
+        pool_->release(slot_);
+        pool_ = nullptr;
+    }
+}
+
+const uint8_t *FrameHandle::data() const { return pool_ ? pool_->slots_[slot_].data : nullptr; }
+
+uint64_t FrameHandle::frameId() const { return pool_ ? pool_->slots_[slot_].frameId : 0; }
+
+uint64_t FrameHandle::timestamp() const { return pool_ ? pool_->slots_[slot_].timestamp : 0; }
+
+FrameStaging::FrameStaging(size_t slotCount, size_t imageSize, bool copyFrames)
+    : pool_(slotCount), imageSize_(imageSize), memory_(copyFrames ? slotCount * imageSize : 0) {}
+
+bool FrameStaging::stage(const uint8_t *pixels, uint64_t frameId, uint64_t timestamp, size_t &slot)
+{
+    pool_.reclaim([](size_t) {});
+    if (!pool_.acquire(slot))
+        return false;
+
+    if (memory_.empty())
+    {
+        pool_.publish(slot, pixels, frameId, timestamp);
+        return true;
+    }
+    uint8_t *target = memory_.data() + slot * imageSize_;
+    std::memcpy(target, pixels, imageSize_);
+    pool_.publish(slot, target, frameId, timestamp);
+    return true;
+}
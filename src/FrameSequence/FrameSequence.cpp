@@ -0,0 +1,280 @@
+#include "FrameSequence/FrameSequence.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MemoryFrameSequence::MemoryFrameSequence(size_t frameSize, size_t reserveFrames) : frameSize_(frameSize)
+{
+    if (frameSize_ == 0)
+        throw std::invalid_argument("MemoryFrameSequence needs a non-zero frame size");
+    data_.reserve(frameSize_ * reserveFrames);
+}
+
+void MemoryFrameSequence::append(const uint8_t *pixels)
+{
+    data_.insert(data_.end(), pixels, pixels + frameSize_);
+}
+
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map empty file " + path);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map " + path);
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map " + path);
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot map empty file " + path);
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED)
+        throw std::runtime_error("Cannot map " + path);
+
+    // Replay walks the file front to back
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(info.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+#ifdef _WIN32
+        file_ = other.file_;
+        mapping_ = other.mapping_;
+        other.file_ = nullptr;
+        other.mapping_ = nullptr;
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    if (file_)
+        CloseHandle(file_);
+    file_ = nullptr;
+    mapping_ = nullptr;
+#else
+    if (data_)
+        munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+namespace
+{
+    // Bytes per pixel of an OpenCV type code (depth in the low 3 bits, channels - 1 above)
+    size_t pixelSize(int type)
+    {
+        static const size_t depthBytes[8] = {1, 1, 2, 2, 4, 4, 8, 2};
+        const int depth = type & 7;
+        const int channels = ((type >> 3) & 511) + 1;
+        return depthBytes[depth] * static_cast<size_t>(channels);
+    }
+
+    int readInt(const uint8_t *data)
+    {
+        int value;
+        std::memcpy(&value, data, sizeof(int));
+        return value;
+    }
+}
+
+BinFrameSequence::BinFrameSequence(const std::string &path, size_t leadingInts) : file_(path)
+{
+    const size_t headerSize = (leadingInts + 3) * sizeof(int);
+    const uint8_t *data = file_.data();
+    size_t offset = 0;
+
+    // Only the headers are touched here, the pixels stay on disk until replayed
+    while (offset + headerSize <= file_.size())
+    {
+        const uint8_t *header = data + offset + leadingInts * sizeof(int);
+        const int rows = readInt(header);
+        const int cols = readInt(header + sizeof(int));
+        const int type = readInt(header + 2 * sizeof(int));
+        if (rows <= 0 || cols <= 0 || type < 0)
+            break; // Not a record header, the rest of the file can't be trusted
+
+        const size_t recordSize = static_cast<size_t>(rows) * static_cast<size_t>(cols) * pixelSize(type);
+        if (offset + headerSize + recordSize > file_.size())
+            break; // Truncated last record, e.g. a capture that was interrupted
+
+        if (offsets_.empty())
+        {
+            rows_ = rows;
+            cols_ = cols;
+            type_ = type;
+            frameSize_ = recordSize;
+        }
+        if (rows == rows_ && cols == cols_ && type == type_)
+            offsets_.push_back(offset + headerSize);
+        else
+            skipped_++;
+
+        offset += headerSize + recordSize;
+    }
+
+    if (offsets_.empty())
+        throw std::runtime_error("No frames found in " + path);
+}
+
+namespace
+{
+    constexpr char PackedMagic[8] = {'M', 'I', 'B', 'F', 'R', 'M', 'S', '1'};
+
+    // Fixed-width fields, the file is only ever read back on the machine that wrote it
+    struct PackedHeader
+    {
+        char magic[8];
+        int32_t rows;
+        int32_t cols;
+        int32_t type;
+        int32_t reserved;
+        uint64_t frameCount;
+        uint64_t frameSize;
+        uint64_t fingerprint;
+    };
+    static_assert(sizeof(PackedHeader) <= PackedFrameSequence::HeaderSize, "Packed header does not fit");
+}
+
+PackedFrameSequence::PackedFrameSequence(const std::string &path) : file_(path)
+{
+    PackedHeader header;
+    if (file_.size() < HeaderSize)
+        throw std::runtime_error("Not a frame cache: " + path);
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, PackedMagic, sizeof(PackedMagic)) != 0 || header.rows <= 0 || header.cols <= 0 ||
+        header.frameSize != static_cast<uint64_t>(header.rows) * header.cols * pixelSize(header.type))
+        throw std::runtime_error("Not a frame cache: " + path);
+    if (header.frameCount == 0 || HeaderSize + header.frameCount * header.frameSize > file_.size())
+        throw std::runtime_error("Truncated frame cache: " + path);
+
+    frameCount_ = static_cast<size_t>(header.frameCount);
+    rows_ = header.rows;
+    cols_ = header.cols;
+    type_ = header.type;
+    frameSize_ = static_cast<size_t>(header.frameSize);
+    fingerprint_ = header.fingerprint;
+}
+
+PackedFrameWriter::PackedFrameWriter(const std::string &path, int rows, int cols, int type, uint64_t fingerprint)
+    : path_(path), tempPath_(path + ".tmp"), rows_(rows), cols_(cols), type_(type),
+      frameSize_(static_cast<size_t>(rows) * cols * pixelSize(type)), fingerprint_(fingerprint)
+{
+    file_.open(tempPath_, std::ios::binary | std::ios::trunc);
+    if (!file_)
+        throw std::runtime_error("Cannot create " + tempPath_);
+    writeHeader(); // Placeholder until the frame count is known
+}
+
+PackedFrameWriter::~PackedFrameWriter()
+{
+    if (!finished_)
+    {
+        file_.close();
+        std::remove(tempPath_.c_str());
+    }
+}
+
+void PackedFrameWriter::writeHeader()
+{
+    PackedHeader header{};
+    std::memcpy(header.magic, PackedMagic, sizeof(PackedMagic));
+    header.rows = rows_;
+    header.cols = cols_;
+    header.type = type_;
+    header.frameCount = frameCount_;
+    header.frameSize = frameSize_;
+    header.fingerprint = fingerprint_;
+
+    char block[PackedFrameSequence::HeaderSize] = {};
+    std::memcpy(block, &header, sizeof(header));
+    file_.seekp(0);
+    file_.write(block, sizeof(block));
+}
+
+void PackedFrameWriter::append(const uint8_t *pixels)
+{
+    file_.write(reinterpret_cast<const char *>(pixels), static_cast<std::streamsize>(frameSize_));
+    frameCount_++;
+}
+
+void PackedFrameWriter::finish()
+{
+    writeHeader();
+    file_.close();
+    if (!file_)
+        throw std::runtime_error("Failed to write " + tempPath_);
+
+    std::error_code error;
+    std::filesystem::rename(tempPath_, path_, error);
+    if (error)
+        throw std::runtime_error("Cannot replace " + path_ + ": " + error.message());
+    finished_ = true;
+}
@@ -0,0 +1,56 @@
+#include "LatencyGovernor/LatencyGovernor.h"
+#include <algorithm>
+
+namespace
+{
+    const char *tierNames[LatencyGovernor::TierCount] = {"none", "brightness", "brightness, ring stats",
+                                                         "brightness, ring stats, previews",
+                                                         "brightness, ring stats, previews, scatter"};
+}
+
+void LatencyGovernor::configure(double budgetUs, size_t window, double restoreFraction)
+{
+    window = std::max<size_t>(window, 16);
+    window_.assign(window, 0.0);
+    sorted_.assign(window, 0.0);
+    next_ = 0;
+    restoreFraction_ = restoreFraction;
+    tier_ = Full;
+    p99Us_ = 0.0;
+    tierChanges_ = 0;
+    budgetUs_ = std::max(0.0, budgetUs);
+}
+
+void LatencyGovernor::record(double processingUs)
+{
+    if (!enabled())
+        return;
+
+    window_[next_++] = processingUs;
+    if (next_ < window_.size())
+        return;
+    next_ = 0;
+
+    // A full window since the last decision, so it only holds frames analyzed under the current tier
+    std::copy(window_.begin(), window_.end(), sorted_.begin());
+    const size_t rank = sorted_.size() * 99 / 100;
+    std::nth_element(sorted_.begin(), sorted_.begin() + rank, sorted_.end());
+    const double p99 = sorted_[rank];
+    p99Us_.store(p99, std::memory_order_relaxed);
+
+    const double budget = budgetUs();
+    int current = tier();
+    if (p99 > budget && current < TierCount - 1)
+        current++;
+    else if (p99 < budget * restoreFraction_ && current > Full)
+        current--;
+    else
+        return;
+    tier_.store(current, std::memory_order_relaxed);
+    tierChanges_.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char *LatencyGovernor::tierName(int tier)
+{
+    return tier >= 0 && tier < TierCount ? tierNames[tier] : "?";
+}
@@ -0,0 +1,119 @@
+#include "acquisition/acquisition.h"
+#include <algorithm>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+bool dispatchStagedFrame(SharedResources &shared, FrameStaging &staging, const uint8_t *pixels,
+                         FrameDescriptor descriptor, bool toDisplay)
+{
+    if (!staging.stage(pixels, descriptor.frameId, descriptor.timestamp, descriptor.slot))
+    {
+        shared.framePoolExhausted.fetch_add(1, std::memory_order_relaxed);
+        accountDroppedFrame(shared, descriptor.frameId);
+        return false;
+    }
+    if (!dispatchFrame(shared, descriptor, toDisplay))
+    {
+        // Processing ring full, the slot goes straight back
+        staging.pool().adopt(descriptor.slot);
+        return false;
+    }
+    return true;
+}
+
+FrameDelivery::FrameDelivery(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging &staging,
+                             bool historyEveryFrame)
+    : shared_(shared), historyBuffer_(historyBuffer), staging_(staging), historyEveryFrame_(historyEveryFrame) {}
+
+bool FrameDelivery::onFrame(const uint8_t *pixels, uint64_t frameId, uint64_t timestamp, bool incomplete)
+{
+    if (shared_.done)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shared_.paused)
+    {
+        // Frames missed while paused are not camera gaps
+        shared_.hasAcquiredFrame = false;
+        return false;
+    }
+    if (incomplete)
+    {
+        incomplete_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (hasFrame_ && frameId == lastFrameId_)
+    {
+        duplicates_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Several callback threads can deliver slightly out of order, late frames still go on
+    lastFrameId_ = hasFrame_ ? std::max(lastFrameId_, frameId) : frameId;
+    hasFrame_ = true;
+
+    // The live view reads the history ring, so frames it is not waiting for can skip the copy
+    const bool copyToHistory = historyEveryFrame_ || shared_.displayRing.empty();
+    if (copyToHistory)
+    {
+        historyBuffer_.push(pixels);
+    }
+    FrameDescriptor descriptor;
+    descriptor.frameId = frameId;
+    descriptor.timestamp = timestamp;
+    descriptor.enqueueNs = steadyNowNs();
+    return dispatchStagedFrame(shared_, staging_, pixels, descriptor, copyToHistory);
+}
+
+void lowerCurrentThreadPriority()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    sched_param param{};
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
+
+void telemetryThread(SharedResources &shared, std::function<AcquisitionTelemetry()> poll,
+                     std::chrono::milliseconds interval)
+{
+    lowerCurrentThreadPriority();
+
+    const auto step = std::min(interval, std::chrono::milliseconds(50));
+    auto nextPoll = std::chrono::steady_clock::now();
+    while (!shared.done)
+    {
+        if (std::chrono::steady_clock::now() >= nextPoll)
+        {
+            try
+            {
+                AcquisitionTelemetry telemetry = poll();
+                shared.currentFPS = telemetry.frameRate;
+                shared.dataRate = telemetry.dataRate;
+                shared.exposureTime = telemetry.exposureTime;
+                shared.updated = true;
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Telemetry poll failed: " << e.what() << std::endl;
+            }
+            nextPoll += interval;
+        }
+        std::this_thread::sleep_for(step);
+    }
+
+    // Signal that this thread is ready to be joined
+    {
+        std::lock_guard<std::mutex> lock(shared.threadShutdownMutex);
+        shared.threadsReadyToJoin.fetch_add(1, std::memory_order_release);
+        shared.threadShutdownCondition.notify_one();
+    }
+
+    std::cout << "Telemetry thread interrupted." << std::endl;
+}
@@ -0,0 +1,148 @@
+#include "acquisition/acquisition.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // Mean and p99 of a buffer of times in microseconds, left alone when it is empty
+    void summarizeTimes(const CircularBuffer &buffer, double &mean, double &p99Time)
+    {
+        std::vector<double> times;
+        times.reserve(buffer.size());
+        for (size_t i = 0; i < buffer.size(); i++)
+        {
+            times.push_back(*reinterpret_cast<const double *>(buffer.getPointer(i)));
+        }
+        if (times.empty())
+            return;
+
+        double total = 0.0;
+        for (double time : times)
+        {
+            total += time;
+        }
+        mean = total / times.size();
+        const size_t p99 = std::min(times.size() - 1, times.size() * 99 / 100);
+        std::nth_element(times.begin(), times.begin() + p99, times.end());
+        p99Time = times[p99];
+    }
+}
+
+cv::Rect headlessRoi(const json &config, const ImageParams &params)
+{
+    const int width = static_cast<int>(params.width);
+    const int height = static_cast<int>(params.height);
+    if (config.contains("headless_roi") && config["headless_roi"].is_array() && config["headless_roi"].size() == 4)
+    {
+        const auto &roi = config["headless_roi"];
+        cv::Rect configured(roi[0].get<int>(), roi[1].get<int>(), roi[2].get<int>(), roi[3].get<int>());
+        return configured & cv::Rect(0, 0, width, height);
+    }
+    return cv::Rect(width / 10, 1, width - 2 * (width / 10), std::max(1, height - 2));
+}
+
+PipelineRunStats runHeadlessPipeline(FrameSource &source, SharedResources &shared,
+                                     std::chrono::milliseconds duration, uint64_t maxFrames, int batchSize)
+{
+    const ImageParams &params = source.params();
+    CircularBuffer historyBuffer(params.bufferCount, params.imageSize);
+
+    json config = readConfig("config.json");
+    // Sources without a frame pool of their own stage into one sized to what the workers can hold,
+    // copying only frames that do not stay valid for the whole run
+    std::unique_ptr<FrameStaging> staging;
+    if (!source.framePool())
+    {
+        staging = std::make_unique<FrameStaging>(processingFramesInFlight(shared, config, batchSize), params.imageSize,
+                                                 !source.stableFrames());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shared.processingConfigMutex);
+        shared.processingConfig = getProcessingConfig(config);
+        shared.roi = headlessRoi(config, params);
+    }
+    source.initializeBackground(shared);
+    publishPipelineSnapshot(shared);
+
+    shared.done = false;
+    shared.paused = false;
+    shared.running = false; // Nothing is recorded, there is no saving thread
+    resetFrameAccounting(shared);
+    shared.activeThreadCount = 0;
+    shared.threadsReadyToJoin = 0;
+    shared.framePacer = source.pacer();
+    shared.framePool = staging ? &staging->pool() : source.framePool();
+
+    std::unique_ptr<GatingScore> score;
+    if (source.groundTruth())
+    {
+        score = std::make_unique<GatingScore>(*source.groundTruth());
+        score->attach(shared);
+    }
+
+    const uint64_t bufferGrowths = contourBufferGrowths();
+    std::vector<std::thread> threads;
+    startProcessingWorkers(shared, params, threads, batchSize);
+    source.startThreads(shared, threads);
+
+    // Ends the run, the source returns from run() once done is set
+    const auto start = std::chrono::steady_clock::now();
+    std::thread stopper([&]()
+                        {
+                            while (!shared.done)
+                            {
+                                const bool timeUp = std::chrono::steady_clock::now() - start >= duration;
+                                const bool enoughFrames = maxFrames > 0 && shared.frameAccounting.acquired.load() >= maxFrames;
+                                if (timeUp || enoughFrames)
+                                {
+                                    shared.done = true;
+                                }
+                                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            } });
+
+    source.run(shared, historyBuffer, staging.get());
+    shared.done = true;
+    stopper.join();
+    const auto end = std::chrono::steady_clock::now();
+
+    wakeFrameConsumers(shared);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    shared.framePacer = nullptr;
+    shared.framePool = nullptr;
+    shared.resultObserver = nullptr;
+    source.printSummary();
+    if (score)
+    {
+        score->print();
+    }
+
+    PipelineRunStats stats;
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    const auto &accounting = shared.frameAccounting;
+    stats.acquired = accounting.acquired.load();
+    stats.analyzed = accounting.analyzed.load();
+    stats.cameraGaps = accounting.cameraGaps.load();
+    stats.queueOverflows = accounting.queueOverflows.load();
+    stats.analysisDrops = accounting.analysisDrops.load();
+    stats.earlyRejects = accounting.earlyRejects.load();
+    stats.handoffLatencyUs = shared.handoffLatencyNs.load() / 1000.0;
+    stats.pipelineKernels = loadPipelineSnapshot(shared)->kernels.name;
+    stats.batchSize = shared.processingBatchSize.load();
+    stats.contourBufferGrowths = contourBufferGrowths() - bufferGrowths;
+    if (shared.latencyGovernor.enabled())
+    {
+        stats.shedding = LatencyGovernor::tierName(shared.latencyGovernor.tier());
+        stats.sheddingChanges = shared.latencyGovernor.tierChanges();
+    }
+    summarizeTimes(shared.processingTimes, stats.meanProcessingUs, stats.p99ProcessingUs);
+    summarizeTimes(shared.triggerLatencies, stats.meanTriggerLatencyUs, stats.p99TriggerLatencyUs);
+    if (score && score->total() > 0)
+    {
+        stats.gatingAccuracy = score->accuracy();
+    }
+    return stats;
+}
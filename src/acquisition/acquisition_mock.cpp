@@ -0,0 +1,114 @@
+#include "acquisition/acquisition.h"
+#include <algorithm>
+
+MockCallbackGrabber::MockCallbackGrabber(const FrameSequence &frames, size_t imageSize, double frameRate,
+                                         size_t callbackThreads, Handler onNewBuffer)
+    : frames_(frames), imageSize_(imageSize), callbackThreads_(std::max<size_t>(1, callbackThreads)),
+      pacer_(frameRate), onNewBuffer_(std::move(onNewBuffer))
+{
+    if (frames_.frameCount() == 0)
+        throw std::invalid_argument("MockCallbackGrabber needs at least one frame");
+}
+
+MockCallbackGrabber::~MockCallbackGrabber() { stop(); }
+
+void MockCallbackGrabber::start()
+{
+    if (running_.exchange(true))
+        return;
+
+    for (size_t i = 0; i < callbackThreads_; i++)
+    {
+        callbacks_.emplace_back(&MockCallbackGrabber::callbackLoop, this);
+    }
+    generator_ = std::thread(&MockCallbackGrabber::generatorLoop, this);
+}
+
+void MockCallbackGrabber::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    announced_.wake();
+    if (generator_.joinable())
+        generator_.join();
+    for (auto &thread : callbacks_)
+    {
+        thread.join();
+    }
+    callbacks_.clear();
+}
+
+AcquisitionTelemetry MockCallbackGrabber::telemetry() const
+{
+    AcquisitionTelemetry telemetry;
+    telemetry.frameRate = measuredRate_.load(std::memory_order_relaxed);
+    telemetry.dataRate = telemetry.frameRate * static_cast<double>(imageSize_);
+    return telemetry;
+}
+
+void MockCallbackGrabber::generatorLoop()
+{
+    using clock = std::chrono::steady_clock;
+    const size_t frameCount = frames_.frameCount();
+
+    size_t index = 0;
+    uint64_t frameId = 0;
+    uint64_t windowFrames = 0;
+    auto windowStart = clock::now();
+    pacer_.reset();
+
+    while (running_)
+    {
+        size_t due = 1;
+        if (pacer_.freeRun())
+        {
+            if (announced_.size() >= callbackThreads_ || (freeRunGate_ && !freeRunGate_()))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            pacer_.markFrame();
+        }
+        else
+        {
+            due = pacer_.waitNext();
+        }
+
+        auto now = clock::now();
+        for (size_t i = 0; i < due; i++)
+        {
+            MockBuffer buffer;
+            buffer.pixels = frames_.frame(index);
+            buffer.frameId = frameId++;
+            buffer.timestamp = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count());
+            index = (index + 1) % frameCount;
+
+            if (!announced_.tryPush(buffer))
+            {
+                lost_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        generated_.fetch_add(due, std::memory_order_relaxed);
+
+        windowFrames += due;
+        if (now - windowStart >= std::chrono::seconds(1))
+        {
+            measuredRate_.store(windowFrames / std::chrono::duration<double>(now - windowStart).count(),
+                                std::memory_order_relaxed);
+            windowFrames = 0;
+            windowStart = now;
+        }
+    }
+}
+
+void MockCallbackGrabber::callbackLoop()
+{
+    MockBuffer buffer;
+    while (announced_.waitPop(buffer, [this]()
+                              { return !running_.load(); }))
+    {
+        onNewBuffer_(buffer);
+    }
+}
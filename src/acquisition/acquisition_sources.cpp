@@ -0,0 +1,187 @@
+#include "acquisition/acquisition.h"
+#include <iomanip>
+#include <iostream>
+
+FramePacer makeSimCameraPacer(const json &config)
+{
+    const bool freeRun = config.value("simCameraFreeRun", false);
+    const double targetFPS = config.value("simCameraTargetFPS", 5000);
+    return FramePacer(freeRun ? 0.0 : targetFPS, std::chrono::microseconds(config.value("simCameraSpinUs", 50)));
+}
+
+void printPacerStats(const FramePacer &pacer)
+{
+    FramePacer::Stats stats = pacer.stats();
+    std::cout << "Frame pacing: " << stats.frames << " frames, interval mean " << std::fixed << std::setprecision(1)
+              << stats.meanIntervalUs << " us, max " << stats.maxIntervalUs << " us";
+    if (!pacer.freeRun())
+    {
+        std::cout << ", target " << stats.targetIntervalUs << " us" << std::endl
+                  << "Achieved/target interval:";
+        for (size_t i = 0; i < FramePacer::HistogramBins; i++)
+        {
+            std::cout << " " << FramePacer::binLabel(i) << ": " << stats.histogram[i];
+        }
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+SequenceFrameSource::SequenceFrameSource(MockFrameSet frames, const json &config)
+    : frames_(std::move(frames)), name_(frames_.origin), pacer_(makeSimCameraPacer(config)),
+      historyEveryFrame_(config.value("zero_copy_history", std::string("all")) != "display")
+{
+    if (!frames_.frames || frames_.frames->frameCount() == 0)
+        throw std::invalid_argument("SequenceFrameSource needs at least one frame");
+}
+
+void SequenceFrameSource::initializeBackground(SharedResources &shared)
+{
+    initializeMockBackgroundFrame(shared, frames_);
+}
+
+void SequenceFrameSource::run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging)
+{
+    using clock = std::chrono::steady_clock;
+
+    const FrameSequence &cameraFrames = *frames_.frames;
+    size_t currentIndex = 0;
+    size_t totalFrames = cameraFrames.frameCount();
+    auto fpsStartTime = clock::now();
+    size_t frameCount = 0;
+    uint64_t frameId = 0;
+    pacer_.reset();
+
+    while (!shared.done)
+    {
+        if (shared.paused)
+        {
+            shared.hasAcquiredFrame = false; // Frames missed while paused are not camera gaps
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            pacer_.reset();
+            continue;
+        }
+
+        size_t due = 1;
+        if (pacer_.freeRun())
+        {
+            // Free-run: a frame goes out as soon as a worker batch can take it, so the ring never overflows
+            if (shared.processingRing.size() >= static_cast<size_t>(shared.processingWorkers.load() * shared.processingBatchSize.load()))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            pacer_.markFrame();
+        }
+        else
+        {
+            due = pacer_.waitNext();
+        }
+
+        for (size_t i = 0; i < due && !shared.done; i++)
+        {
+            const uint8_t *imageData = cameraFrames.frame(currentIndex);
+            shared.latestCameraFrame.store(currentIndex, std::memory_order_release);
+            // The staging slot references the frame itself, the history copy is only needed for the live view
+            const bool copyToHistory = historyEveryFrame_ || shared.displayRing.empty();
+            if (copyToHistory)
+            {
+                historyBuffer.push(imageData);
+            }
+            FrameDescriptor descriptor;
+            descriptor.frameId = frameId++;
+            descriptor.enqueueNs = steadyNowNs();
+            descriptor.timestamp = static_cast<uint64_t>(descriptor.enqueueNs / 1000);
+            dispatchStagedFrame(shared, *staging, imageData, descriptor, copyToHistory);
+            currentIndex = (currentIndex + 1) % totalFrames;
+            frameCount++;
+        }
+
+        auto now = clock::now();
+        if (now - fpsStartTime >= std::chrono::seconds(1))
+        {
+            double fps = frameCount / std::chrono::duration<double>(now - fpsStartTime).count();
+            shared.currentFPS.store(fps, std::memory_order_release);
+            frameCount = 0;
+            fpsStartTime = now;
+            shared.updated = true;
+        }
+    }
+
+    std::cout << "Camera simulation stopped." << std::endl;
+}
+
+namespace
+{
+    size_t callbackThreadCount(const json &config)
+    {
+        const bool multiThreaded = config.value("acquisition_mode", std::string("on_demand")) == "callback_multi";
+        return multiThreaded ? config.value("callback_threads", 2) : 1;
+    }
+
+    // 0 lets the mock grabber free-run, limited only by how fast the callbacks return
+    double mockFrameRate(const json &config)
+    {
+        return config.value("simCameraFreeRun", false) ? 0.0 : config.value("simCameraTargetFPS", 5000.0);
+    }
+}
+
+MockCallbackFrameSource::MockCallbackFrameSource(MockFrameSet frames, const json &config)
+    : frames_(std::move(frames)),
+      telemetryInterval_(std::max(10, config.value("telemetry_interval_ms", 250))),
+      historyEveryFrame_(config.value("zero_copy_history", std::string("all")) != "display"),
+      grabber_(*frames_.frames, frames_.params.imageSize, mockFrameRate(config), callbackThreadCount(config),
+               [this](const MockBuffer &buffer)
+               { delivery_->onFrame(buffer.pixels, buffer.frameId, buffer.timestamp, buffer.incomplete); })
+{
+}
+
+void MockCallbackFrameSource::initializeBackground(SharedResources &shared)
+{
+    initializeMockBackgroundFrame(shared, frames_);
+}
+
+void MockCallbackFrameSource::startThreads(SharedResources &shared, std::vector<std::thread> &threads)
+{
+    threads.emplace_back(telemetryThread, std::ref(shared),
+                         [this]()
+                         { return grabber_.telemetry(); },
+                         telemetryInterval_);
+}
+
+void MockCallbackFrameSource::run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging)
+{
+    delivery_ = std::make_unique<FrameDelivery>(shared, historyBuffer, *staging, historyEveryFrame_);
+    grabber_.setFreeRunGate([&shared]()
+                            { return shared.processingRing.size() < static_cast<size_t>(shared.processingWorkers.load() * shared.processingBatchSize.load()); });
+
+    // Frames arrive on the callback threads, this thread only waits for shutdown
+    grabber_.start();
+    while (!shared.done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    grabber_.stop();
+}
+
+void MockCallbackFrameSource::printSummary() const
+{
+    printPacerStats(grabber_.pacer());
+    std::cout << "Mock callback acquisition: " << grabber_.framesGenerated() << " frames generated, "
+              << grabber_.framesLost() << " lost before a callback thread took them";
+    if (delivery_)
+    {
+        std::cout << ", " << delivery_->duplicateCount() << " duplicate, "
+                  << delivery_->incompleteCount() << " incomplete";
+    }
+    std::cout << std::endl;
+}
+
+std::unique_ptr<FrameSource> makeMockFrameSource(MockFrameSet frames, const json &config)
+{
+    const std::string acquisitionMode = config.value("acquisition_mode", std::string("on_demand"));
+    if (acquisitionMode == "callback_single" || acquisitionMode == "callback_multi")
+    {
+        return std::make_unique<MockCallbackFrameSource>(std::move(frames), config);
+    }
+    return std::make_unique<SequenceFrameSource>(std::move(frames), config);
+}
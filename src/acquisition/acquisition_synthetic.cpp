@@ -0,0 +1,365 @@
+#include "acquisition/acquisition.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    // Generated frames are kept in memory, larger requests are cut down to this
+    constexpr size_t MaxSyntheticBytes = size_t(1) << 30;
+    constexpr int DrawShift = 4; // Sub-pixel bits for cv::ellipse
+    constexpr int BorderMargin = 3; // Keeps interior cells clear of the 2 px border check
+
+    struct CellShape
+    {
+        double outerRadius;
+        double ringWidth;
+        double radiusJitter;
+        double deformation;
+        double contrast;
+    };
+
+    struct Cell
+    {
+        cv::Point2f center;
+        double outerRadius;
+        double innerRadius;
+        double stretch; // Major/minor axis ratio is stretch^2
+        double angle;
+        bool crossesBorder;
+    };
+
+    // Bright channel that darkens slightly towards the walls, like the recorded backgrounds
+    cv::Mat syntheticBackground(int width, int height)
+    {
+        cv::Mat background(height, width, CV_8UC1);
+        for (int y = 0; y < height; y++)
+        {
+            const double wall = std::sin(M_PI * (y + 0.5) / height);
+            background.row(y).setTo(cv::Scalar(170 + 40 * wall));
+        }
+        return background;
+    }
+
+    Cell randomCell(const CellShape &shape, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        Cell cell;
+        cell.outerRadius = shape.outerRadius * (1.0 + shape.radiusJitter * (2.0 * unit(rng) - 1.0));
+        cell.innerRadius = std::max(1.0, cell.outerRadius - shape.ringWidth);
+        cell.stretch = 1.0 + shape.deformation * unit(rng);
+        cell.angle = 20.0 * unit(rng) - 10.0; // Cells flow along the channel
+        cell.crossesBorder = false;
+        return cell;
+    }
+
+    // Interior cells keep their whole outline inside the ROI, border cells have their centre
+    // close enough to one ROI edge that the ring is cut or the hole comes within the border check
+    void placeCell(Cell &cell, const cv::Rect &roi, bool crossesBorder, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const double reach = cell.outerRadius * cell.stretch + BorderMargin;
+        cell.crossesBorder = crossesBorder;
+        if (!crossesBorder)
+        {
+            const double spanX = std::max(0.0, roi.width - 2 * reach);
+            const double spanY = std::max(0.0, roi.height - 2 * reach);
+            cell.center = cv::Point2f(static_cast<float>(roi.x + reach + spanX * unit(rng)),
+                                      static_cast<float>(roi.y + reach + spanY * unit(rng)));
+            return;
+        }
+
+        const double depth = (cell.innerRadius + 2.0) * unit(rng);
+        const int edge = static_cast<int>(unit(rng) * 4) % 4;
+        const double alongX = roi.x + roi.width * unit(rng);
+        const double alongY = roi.y + roi.height * unit(rng);
+        switch (edge)
+        {
+        case 0:
+            cell.center = cv::Point2f(static_cast<float>(alongX), static_cast<float>(roi.y + depth));
+            break;
+        case 1:
+            cell.center = cv::Point2f(static_cast<float>(alongX), static_cast<float>(roi.y + roi.height - 1 - depth));
+            break;
+        case 2:
+            cell.center = cv::Point2f(static_cast<float>(roi.x + depth), static_cast<float>(alongY));
+            break;
+        default:
+            cell.center = cv::Point2f(static_cast<float>(roi.x + roi.width - 1 - depth), static_cast<float>(alongY));
+            break;
+        }
+    }
+
+    bool overlaps(const Cell &cell, const std::vector<Cell> &cells)
+    {
+        for (const Cell &other : cells)
+        {
+            const double dx = cell.center.x - other.center.x;
+            const double dy = cell.center.y - other.center.y;
+            const double minDistance = cell.outerRadius * cell.stretch + other.outerRadius * other.stretch + 2.0;
+            if (dx * dx + dy * dy < minDistance * minDistance)
+                return true;
+        }
+        return false;
+    }
+
+    void drawEllipse(cv::Mat &image, const Cell &cell, double radius, double value)
+    {
+        const double scale = 1 << DrawShift;
+        const cv::Point center(static_cast<int>(std::lround(cell.center.x * scale)),
+                               static_cast<int>(std::lround(cell.center.y * scale)));
+        const cv::Size axes(static_cast<int>(std::lround(radius * cell.stretch * scale)),
+                            static_cast<int>(std::lround(radius / cell.stretch * scale)));
+        cv::ellipse(image, center, axes, cell.angle, 0, 360, cv::Scalar(value), cv::FILLED, cv::LINE_AA, DrawShift);
+    }
+
+    // Bright ring around a hole at background level, the only foreground the pipeline keeps
+    // after subtracting the background
+    void drawCell(cv::Mat &signal, const Cell &cell, double contrast)
+    {
+        drawEllipse(signal, cell, cell.outerRadius, contrast);
+        drawEllipse(signal, cell, cell.innerRadius, 0);
+    }
+
+    FrameTruth labelFrame(const std::vector<Cell> &cells)
+    {
+        for (const Cell &cell : cells)
+        {
+            if (cell.crossesBorder)
+                return FrameTruth::Border;
+        }
+        if (cells.size() >= 2)
+            return FrameTruth::Doublet;
+        return cells.empty() ? FrameTruth::Empty : FrameTruth::Valid;
+    }
+
+    void writeImageRecord(std::ofstream &file, const cv::Mat &image)
+    {
+        const int rows = image.rows;
+        const int cols = image.cols;
+        const int type = image.type();
+        file.write(reinterpret_cast<const char *>(&rows), sizeof(int));
+        file.write(reinterpret_cast<const char *>(&cols), sizeof(int));
+        file.write(reinterpret_cast<const char *>(&type), sizeof(int));
+        file.write(reinterpret_cast<const char *>(image.data), image.total() * image.elemSize());
+    }
+
+    // Same layout as a recorded condition, so openMockFrames() and the review tools read it back
+    void saveSyntheticDataset(const std::string &directory, const MockFrameSet &mock, const cv::Mat &background,
+                              const std::vector<uint8_t> &cellCounts)
+    {
+        std::filesystem::create_directories(directory);
+        const int width = static_cast<int>(mock.params.width);
+        const int height = static_cast<int>(mock.params.height);
+
+        std::ofstream images(directory + "/synthetic_images.bin", std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < mock.frames->frameCount(); i++)
+        {
+            cv::Mat frame(height, width, CV_8UC1, const_cast<uint8_t *>(mock.frames->frame(i)));
+            writeImageRecord(images, frame);
+        }
+
+        std::ofstream backgrounds(directory + "/synthetic_backgrounds.bin", std::ios::binary | std::ios::trunc);
+        const int batch = 0;
+        backgrounds.write(reinterpret_cast<const char *>(&batch), sizeof(int));
+        writeImageRecord(backgrounds, background);
+
+        std::ofstream truth(directory + "/synthetic_ground_truth.csv", std::ios::trunc);
+        truth << "Frame,Label,Cells\n";
+        for (size_t i = 0; i < mock.truth.size(); i++)
+        {
+            truth << i << "," << frameTruthName(mock.truth[i]) << "," << static_cast<int>(cellCounts[i]) << "\n";
+        }
+
+        if (!images || !backgrounds || !truth)
+        {
+            throw std::runtime_error("Failed to write the synthetic dataset to " + directory);
+        }
+        std::cout << "Saved synthetic dataset to " << directory << std::endl;
+    }
+}
+
+const char *frameTruthName(FrameTruth truth)
+{
+    switch (truth)
+    {
+    case FrameTruth::Empty:
+        return "empty";
+    case FrameTruth::Valid:
+        return "valid";
+    case FrameTruth::Doublet:
+        return "doublet";
+    case FrameTruth::Border:
+        return "border";
+    }
+    return "unknown";
+}
+
+MockFrameSet makeSyntheticFrames(const json &config)
+{
+    const int width = config.value("synthetic_width", 512);
+    const int height = config.value("synthetic_height", 96);
+    size_t frameCount = static_cast<size_t>(std::max(1, config.value("synthetic_frames", 1000)));
+    const double noise = config.value("synthetic_noise", 4.0);
+    const double density = std::max(0.0, config.value("synthetic_density", 0.8));
+    const double borderFraction = std::clamp(config.value("synthetic_border_fraction", 0.1), 0.0, 1.0);
+    const CellShape shape{config.value("synthetic_cell_radius", 16.0),
+                          config.value("synthetic_ring_width", 4.0),
+                          std::clamp(config.value("synthetic_radius_jitter", 0.1), 0.0, 0.9),
+                          std::max(0.0, config.value("synthetic_deformation", 0.15)),
+                          config.value("synthetic_cell_contrast", 40.0)};
+    if (width <= 0 || height <= 0)
+    {
+        throw std::runtime_error("synthetic_width and synthetic_height must be positive");
+    }
+    if (shape.outerRadius <= 0 || shape.ringWidth <= 0)
+    {
+        throw std::runtime_error("synthetic_cell_radius and synthetic_ring_width must be positive");
+    }
+
+    MockFrameSet mock;
+    mock.origin = "synthetic";
+    mock.params.width = static_cast<size_t>(width);
+    mock.params.height = static_cast<size_t>(height);
+    mock.params.pixelFormat = CV_8UC1;
+    mock.params.imageSize = mock.params.width * mock.params.height;
+    mock.params.bufferCount = config.value("simCameraTargetFPS", 5000);
+
+    if (frameCount * mock.params.imageSize > MaxSyntheticBytes)
+    {
+        frameCount = std::max<size_t>(1, MaxSyntheticBytes / mock.params.imageSize);
+        std::cerr << "Warning: synthetic_frames limited to " << frameCount << " to stay within "
+                  << (MaxSyntheticBytes >> 20) << " MB" << std::endl;
+    }
+
+    const cv::Mat background = syntheticBackground(width, height);
+    auto backgrounds = std::make_unique<MemoryFrameSequence>(mock.params.imageSize, 1);
+    backgrounds->append(background.data);
+
+    // Cells are placed relative to the ROI the headless runs analyze
+    const cv::Rect roi = headlessRoi(config, mock.params);
+
+    // Fixed seed, so runs with the same config see the same frames and labels
+    const int seed = config.value("synthetic_seed", 1);
+    cv::RNG rng(seed);
+    std::mt19937 placementRng(static_cast<uint32_t>(seed));
+    std::poisson_distribution<int> cellsPerFrame(density);
+    std::bernoulli_distribution atBorder(borderFraction);
+
+    cv::Mat sensorNoise(height, width, CV_16SC1);
+    cv::Mat signal(height, width, CV_8UC1);
+    cv::Mat frame;
+    std::vector<Cell> cells;
+    std::vector<uint8_t> cellCounts;
+    cellCounts.reserve(frameCount);
+    mock.truth.reserve(frameCount);
+    auto frames = std::make_unique<MemoryFrameSequence>(mock.params.imageSize, frameCount);
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        cells.clear();
+        const int wanted = cellsPerFrame(placementRng);
+        for (int c = 0; c < wanted; c++)
+        {
+            // A few tries to keep cells apart, touching cells would read as one odd shape
+            Cell cell = randomCell(shape, placementRng);
+            const bool crossesBorder = atBorder(placementRng);
+            for (int attempt = 0; attempt < 10; attempt++)
+            {
+                placeCell(cell, roi, crossesBorder, placementRng);
+                if (!overlaps(cell, cells))
+                {
+                    cells.push_back(cell);
+                    break;
+                }
+            }
+        }
+
+        signal.setTo(cv::Scalar(0));
+        for (const Cell &cell : cells)
+        {
+            drawCell(signal, cell, shape.contrast);
+        }
+        rng.fill(sensorNoise, cv::RNG::NORMAL, 0, noise);
+        cv::add(background, signal, frame);
+        cv::add(frame, sensorNoise, frame, cv::noArray(), CV_8U);
+        frames->append(frame.data);
+
+        mock.truth.push_back(labelFrame(cells));
+        cellCounts.push_back(static_cast<uint8_t>(std::min<size_t>(cells.size(), 255)));
+    }
+
+    mock.frames = std::move(frames);
+    mock.backgrounds = std::move(backgrounds);
+
+    size_t labelCounts[4] = {};
+    for (FrameTruth truth : mock.truth)
+    {
+        labelCounts[static_cast<size_t>(truth)]++;
+    }
+    std::cout << "Generated " << frameCount << " synthetic " << width << "x" << height << " frames: "
+              << labelCounts[static_cast<size_t>(FrameTruth::Valid)] << " valid, "
+              << labelCounts[static_cast<size_t>(FrameTruth::Doublet)] << " doublet, "
+              << labelCounts[static_cast<size_t>(FrameTruth::Border)] << " border, "
+              << labelCounts[static_cast<size_t>(FrameTruth::Empty)] << " empty." << std::endl;
+
+    const std::string saveDirectory = config.value("synthetic_save_directory", std::string(""));
+    if (!saveDirectory.empty())
+    {
+        saveSyntheticDataset(saveDirectory, mock, background, cellCounts);
+    }
+    return mock;
+}
+
+void GatingScore::attach(SharedResources &shared)
+{
+    shared.resultObserver = [this](const FrameResult &result)
+    { record(result.frameId, result.filterResult.isValid); };
+}
+
+void GatingScore::record(uint64_t frameId, bool accepted)
+{
+    if (truth_.empty())
+        return;
+    const FrameTruth truth = truth_[frameId % truth_.size()];
+    counts_[static_cast<size_t>(truth)][accepted ? 1 : 0]++;
+}
+
+uint64_t GatingScore::total() const
+{
+    uint64_t sum = 0;
+    for (const auto &row : counts_)
+    {
+        sum += row[0] + row[1];
+    }
+    return sum;
+}
+
+double GatingScore::accuracy() const
+{
+    const uint64_t frames = total();
+    if (frames == 0)
+        return 0.0;
+    uint64_t correct = 0;
+    for (size_t truth = 0; truth < 4; truth++)
+    {
+        const bool shouldAccept = static_cast<FrameTruth>(truth) == FrameTruth::Valid;
+        correct += counts_[truth][shouldAccept ? 1 : 0];
+    }
+    return static_cast<double>(correct) / frames;
+}
+
+void GatingScore::print() const
+{
+    std::cout << "Gating against ground truth (accepted/analyzed):";
+    for (size_t truth = 0; truth < 4; truth++)
+    {
+        std::cout << " " << frameTruthName(static_cast<FrameTruth>(truth)) << " "
+                  << counts_[truth][1] << "/" << counts_[truth][0] + counts_[truth][1];
+    }
+    std::cout << std::fixed << std::setprecision(1) << ", accuracy " << 100.0 * accuracy() << "%"
+              << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,127 @@
+#include "image_processing/image_processing.h"
+#include "acquisition/acquisition.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs the processing pipeline without the Euresys SDK or any UI, for throughput and
+// latency measurements on build servers. Pacing, workers and acquisition_mode come from config.json.
+// With a list of batch sizes the same frames run once per size with the camera in free-run,
+// so the analyzed rate is what the workers sustain, and the runs are compared side by side.
+//
+//   MIB_Headless <image directory | synthetic> [seconds] [max frames] [batch sizes, e.g. 1,4,16]
+//   MIB_Headless verify [seed]   checks the specialized kernels against the OpenCV calls
+namespace
+{
+    std::vector<int> parseBatchSizes(const std::string &list)
+    {
+        std::vector<int> sizes;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            sizes.push_back(std::stoi(item));
+        }
+        return sizes;
+    }
+
+    MockFrameSet loadFrames(const std::string &input, const json &config)
+    {
+        return input == "synthetic" ? makeSyntheticFrames(config) : openMockFrames(input);
+    }
+
+    int compareBatchSizes(const std::string &input, std::chrono::milliseconds duration, uint64_t maxFrames,
+                          const std::vector<int> &batchSizes)
+    {
+        json config = readConfig("config.json");
+        config["simCameraFreeRun"] = true;
+
+        std::vector<PipelineRunStats> runs;
+        for (int batchSize : batchSizes)
+        {
+            std::unique_ptr<FrameSource> source = makeMockFrameSource(loadFrames(input, config), config);
+            SharedResources shared;
+            std::cout << "Running " << source->name() << " frames, batch size " << batchSize << std::endl;
+            runs.push_back(runHeadlessPipeline(*source, shared, duration, maxFrames, batchSize));
+        }
+
+        const double baseline = runs.front().analyzed / runs.front().seconds;
+        std::cout << std::fixed << std::setprecision(1) << std::endl
+                  << "Batch   Analyzed fps   Speedup   Processing mean us   Handoff us" << std::endl;
+        for (const PipelineRunStats &stats : runs)
+        {
+            const double rate = stats.analyzed / stats.seconds;
+            std::cout << std::setw(5) << stats.batchSize
+                      << std::setw(15) << rate
+                      << std::setw(9) << std::setprecision(2) << rate / baseline << "x"
+                      << std::setw(21) << std::setprecision(1) << stats.meanProcessingUs
+                      << std::setw(13) << stats.handoffLatencyUs << std::endl;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <image directory | synthetic> [seconds] [max frames] [batch sizes]" << std::endl
+                  << "       " << argv[0] << " verify [seed]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const std::string input = argv[1];
+        if (input == "verify")
+        {
+            const unsigned seed = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 1;
+            return verifyPipelineKernels(seed) == 0 ? 0 : 1;
+        }
+        const double seconds = argc > 2 ? std::stod(argv[2]) : 10.0;
+        const uint64_t maxFrames = argc > 3 ? std::stoull(argv[3]) : 0;
+        const auto duration = std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000));
+        if (argc > 4)
+        {
+            return compareBatchSizes(input, duration, maxFrames, parseBatchSizes(argv[4]));
+        }
+
+        json config = readConfig("config.json");
+        std::unique_ptr<FrameSource> source = makeMockFrameSource(loadFrames(input, config), config);
+
+        SharedResources shared;
+        std::cout << "Running " << source->name() << " frames for " << seconds << " s" << std::endl;
+        PipelineRunStats stats = runHeadlessPipeline(*source, shared, duration, maxFrames);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Elapsed:          " << stats.seconds << " s" << std::endl
+                  << "Acquired:         " << stats.acquired << " (" << stats.acquired / stats.seconds << " fps)" << std::endl
+                  << "Analyzed:         " << stats.analyzed << " (" << stats.analyzed / stats.seconds << " fps)" << std::endl
+                  << "Camera gaps:      " << stats.cameraGaps << std::endl
+                  << "Queue overflows:  " << stats.queueOverflows << std::endl
+                  << "Analysis drops:   " << stats.analysisDrops << std::endl
+                  << "Early rejects:    " << stats.earlyRejects << std::endl
+                  << "Processing time:  mean " << stats.meanProcessingUs << " us, p99 " << stats.p99ProcessingUs << " us" << std::endl
+                  << "Handoff latency:  " << stats.handoffLatencyUs << " us" << std::endl
+                  << "Trigger latency:  mean " << stats.meanTriggerLatencyUs << " us, p99 " << stats.p99TriggerLatencyUs << " us" << std::endl
+                  << "Kernels:          " << stats.pipelineKernels << std::endl
+                  << "Batch size:       " << stats.batchSize << std::endl
+                  << "Contour buffers:  " << stats.contourBufferGrowths << " growths during the run" << std::endl;
+        if (!stats.shedding.empty())
+        {
+            std::cout << "Shedding:         " << stats.shedding << " (" << stats.sheddingChanges << " tier changes)" << std::endl;
+        }
+        if (stats.gatingAccuracy >= 0)
+        {
+            std::cout << "Gating accuracy:  " << 100.0 * stats.gatingAccuracy << " %" << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
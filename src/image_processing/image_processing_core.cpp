@@ -1,11 +1,12 @@
 #include "image_processing/image_processing.h"
 #include "CircularBuffer/CircularBuffer.h"
+#include "ComponentLabeler/ComponentLabeler.h"
 #include <cmath>
+#include <cstring>
 #include <algorithm> // For std::sort and std::nth_element
 
 ThreadLocalMats initializeThreadMats(int height, int width, SharedResources &shared)
 {
-    std::lock_guard<std::mutex> lock(shared.processingConfigMutex);
     ThreadLocalMats mats;
     mats.blurred_target = cv::Mat(height, width, CV_8UC1);
     mats.bg_sub = cv::Mat(height, width, CV_8UC1);
@@ -13,55 +14,179 @@ ThreadLocalMats initializeThreadMats(int height, int width, SharedResources &sha
     mats.dilate1 = cv::Mat(height, width, CV_8UC1);
     mats.erode1 = cv::Mat(height, width, CV_8UC1);
     mats.erode2 = cv::Mat(height, width, CV_8UC1);
-    mats.kernel = cv::getStructuringElement(cv::MORPH_CROSS,
-                                            cv::Size(shared.processingConfig.morph_kernel_size,
-                                                     shared.processingConfig.morph_kernel_size));
+    refreshPipelineSnapshot(shared, mats);
     mats.initialized = true;
     return mats;
 }
 
-void processFrame(const cv::Mat &inputImage, SharedResources &shared,
-                  cv::Mat &outputImage, ThreadLocalMats &mats)
+void publishPipelineSnapshot(SharedResources &shared)
 {
+    // The mutex only orders publishers, readers never take it
     std::lock_guard<std::mutex> lock(shared.processingConfigMutex);
-    cv::Rect roi = shared.roi;
-    // Ensure ROI is within image bounds
-    roi &= cv::Rect(0, 0, inputImage.cols, inputImage.rows);
+    auto snapshot = std::make_shared<PipelineSnapshot>();
+    snapshot->version = shared.pipelineVersion.load(std::memory_order_relaxed) + 1;
+    snapshot->config = shared.processingConfig;
+    snapshot->roi = shared.roi;
+    {
+        // Writers blur into blurredBackground in place under this mutex, callers must not hold it
+        std::lock_guard<std::mutex> backgroundLock(shared.backgroundFrameMutex);
+        snapshot->blurredBackground = shared.blurredBackground.clone();
+    }
+    const int kernelSize = std::max(1, snapshot->config.morph_kernel_size);
+    snapshot->kernel = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(kernelSize, kernelSize));
+    snapshot->kernels = selectPipelineKernels(snapshot->config);
 
-    // Get ROI from the background
-    // Note: The background is already blurred with the same parameters
-    cv::Mat blurred_bg = shared.blurredBackground(roi);
+    std::atomic_store_explicit(&shared.pipelineSnapshot, std::shared_ptr<const PipelineSnapshot>(std::move(snapshot)),
+                               std::memory_order_release);
+    shared.pipelineVersion.fetch_add(1, std::memory_order_release);
+}
 
-    // Process only ROI area
-    auto roiArea = inputImage(roi);
+std::shared_ptr<const PipelineSnapshot> loadPipelineSnapshot(const SharedResources &shared)
+{
+    return std::atomic_load_explicit(&shared.pipelineSnapshot, std::memory_order_acquire);
+}
 
-    // Apply Gaussian blur to reduce noise - same as applied to background
-    cv::GaussianBlur(roiArea, mats.blurred_target(roi),
-                     cv::Size(shared.processingConfig.gaussian_blur_size,
-                              shared.processingConfig.gaussian_blur_size),
-                     0);
+const PipelineSnapshot &refreshPipelineSnapshot(SharedResources &shared, ThreadLocalMats &mats)
+{
+    // Comparing versions is a plain atomic read, the shared_ptr is only loaded after a publish
+    if (mats.snapshot && mats.snapshot->version == shared.pipelineVersion.load(std::memory_order_acquire))
+        return *mats.snapshot;
 
-    // Simple background subtraction
-    cv::subtract(mats.blurred_target(roi), blurred_bg, mats.bg_sub(roi));
+    mats.snapshot = loadPipelineSnapshot(shared);
+    if (!mats.snapshot)
+    {
+        // Nothing published yet, freeze what is there
+        publishPipelineSnapshot(shared);
+        mats.snapshot = loadPipelineSnapshot(shared);
+    }
+    return *mats.snapshot;
+}
 
-    // Apply threshold to create binary image
-    cv::threshold(mats.bg_sub(roi), mats.binary(roi),
-                  shared.processingConfig.bg_subtract_threshold, 255, cv::THRESH_BINARY);
+namespace
+{
+    // Foreground the automatic reject_max_pixels allows per pixel of area_threshold_max. A passing
+    // cell thresholds to its ring, which is much smaller than its hull; the rest is headroom for
+    // specks the opening removes later.
+    const int rejectMaxAreaFactor = 5;
 
-    // Combine operations to reduce memory transfers
-    cv::morphologyEx(mats.binary(roi), mats.dilate1(roi), cv::MORPH_CLOSE, mats.kernel,
-                     cv::Point(-1, -1), shared.processingConfig.morph_iterations);
-    cv::morphologyEx(mats.dilate1(roi), outputImage(roi), cv::MORPH_OPEN, mats.kernel,
-                     cv::Point(-1, -1), shared.processingConfig.morph_iterations);
+    // Foreground above which a frame can't hold a passing cell, 0 for no limit
+    int rejectMaxPixels(const ProcessingConfig &config)
+    {
+        if (config.reject_max_pixels >= 0)
+            return config.reject_max_pixels;
+        return config.enable_area_range_check ? rejectMaxAreaFactor * config.area_threshold_max : 0;
+    }
 
-    if (roi.width != inputImage.cols || roi.height != inputImage.rows)
+    // True if the thresholded ROI can't hold a cell that passes the filters
+    bool rejectEarly(const ForegroundStats &foreground, const ProcessingConfig &config)
     {
-        cv::Mat mask(inputImage.rows, inputImage.cols, CV_8UC1, cv::Scalar(0));
-        mask(roi) = 255;
-        outputImage.setTo(0, mask == 0);
+        if (foreground.pixels < config.reject_min_pixels)
+            return true;
+        // A crowded frame is what multi-object mode is for, its foreground grows with the cell count
+        const int maxPixels = config.multi_object ? 0 : rejectMaxPixels(config);
+        if (maxPixels > 0 && foreground.pixels > maxPixels)
+            return true;
+        // Multi-object cells are always rings measured by their inner contour
+        const bool measuresInnerContour = config.require_single_inner_contour || config.multi_object;
+        if (foreground.pixels == 0 || !config.enable_area_range_check || !measuresInnerContour)
+            return false;
+
+        // Close/open never grows the mask past this box, except by the kernel reach where the
+        // box meets the ROI edge. The hull of the inner contour runs through pixel centres
+        // inside it, so its area is at most (width - 1) * (height - 1). In multi-object mode the
+        // box holds every cell, so a box too small for one cell is too small for all of them.
+        const int reach = (config.morph_kernel_size / 2) * config.morph_iterations;
+        const double width = foreground.bbox.width + 2 * reach - 1;
+        const double height = foreground.bbox.height + 2 * reach - 1;
+        return width * height < config.area_threshold_min;
     }
 }
 
+bool processFrame(const cv::Mat &inputImage, SharedResources &shared,
+                  cv::Mat &outputImage, ThreadLocalMats &mats)
+{
+    // Settings changes take effect here, between frames. The snapshot stays alive in mats
+    // for the rest of the frame, whatever gets published meanwhile.
+    const PipelineSnapshot &snapshot = refreshPipelineSnapshot(shared, mats);
+    const ProcessingConfig &config = snapshot.config;
+    const cv::Mat &blurredBackground = snapshot.blurredBackground;
+
+    // Ensure ROI is within image bounds
+    const cv::Rect roi = snapshot.roi & cv::Rect(0, 0, inputImage.cols, inputImage.rows);
+
+    // Only the ROI of outputImage is written below, everything outside it stays zero. It only
+    // needs clearing when the ROI moved or the caller handed in a different buffer.
+    if (outputImage.data != mats.outputData || roi != mats.roi)
+    {
+        outputImage.setTo(0);
+        mats.outputData = outputImage.data;
+        mats.roi = roi;
+        mats.outputClear = true;
+    }
+
+    // Blur, background subtraction and threshold in a single pass where the kernel allows it.
+    // The early reject needs the foreground stats, the fused pass gathers them as it writes.
+    ForegroundStats foreground;
+    ForegroundStats *stats = config.early_reject ? &foreground : nullptr;
+    const PipelineKernels &kernels = snapshot.kernels;
+    const bool fused = config.fused_preprocessing && kernels.threshold &&
+                       kernels.threshold(inputImage, roi, blurredBackground, config.bg_subtract_threshold,
+                                         mats.binary, mats, stats);
+    if (!fused)
+    {
+        // Get ROI from the background
+        // Note: The background is already blurred with the same parameters
+        cv::Mat blurred_bg = blurredBackground(roi);
+
+        // Process only ROI area
+        auto roiArea = inputImage(roi);
+
+        // Apply Gaussian blur to reduce noise - same as applied to background
+        cv::GaussianBlur(roiArea, mats.blurred_target(roi),
+                         cv::Size(config.gaussian_blur_size,
+                                  config.gaussian_blur_size),
+                         0);
+
+        // Simple background subtraction
+        cv::subtract(mats.blurred_target(roi), blurred_bg, mats.bg_sub(roi));
+
+        // Apply threshold to create binary image
+        cv::threshold(mats.bg_sub(roi), mats.binary(roi),
+                      config.bg_subtract_threshold, 255, cv::THRESH_BINARY);
+        if (stats)
+        {
+            countForeground(mats.binary, roi, foreground);
+        }
+    }
+
+    // Most frames hold no cell: skip morphology and everything after it
+    mats.emptyFrame = stats && foreground.pixels < config.reject_min_pixels;
+    if (stats && rejectEarly(foreground, config))
+    {
+        if (!mats.outputClear)
+        {
+            outputImage(roi).setTo(0);
+            mats.outputClear = true;
+        }
+        return false;
+    }
+    mats.outputClear = false;
+
+    const bool packed = config.packed_morphology &&
+                        (kernels.closeOpen ? kernels.closeOpen(mats.binary, roi, outputImage, mats)
+                                           : packedCloseOpen(mats.binary, roi, snapshot.kernel, config.morph_iterations,
+                                                             outputImage, mats));
+    if (!packed)
+    {
+        // Combine operations to reduce memory transfers
+        cv::morphologyEx(mats.binary(roi), mats.dilate1(roi), cv::MORPH_CLOSE, snapshot.kernel,
+                         cv::Point(-1, -1), config.morph_iterations);
+        cv::morphologyEx(mats.dilate1(roi), outputImage(roi), cv::MORPH_OPEN, snapshot.kernel,
+                         cv::Point(-1, -1), config.morph_iterations);
+    }
+    return true;
+}
+
 double calculateRingRatio(const std::vector<cv::Point> &innerContour, const std::vector<cv::Point> &outerContour)
 {
     // Calculate areas of both contours
@@ -78,74 +203,157 @@ double calculateRingRatio(const std::vector<cv::Point> &innerContour, const std:
     return std::sqrt(outerArea - innerArea);
 }
 
-std::tuple<std::vector<std::vector<cv::Point>>, bool, std::vector<std::vector<cv::Point>>, std::vector<int>> findContours(const cv::Mat &processedImage)
+namespace
 {
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::findContours(processedImage, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
-
-    // Filter out small noise contours
-    std::vector<std::vector<cv::Point>> filteredContours;
-    std::vector<cv::Vec4i> filteredHierarchy;
-
     // Minimum area threshold to filter out noise (adjust as needed)
     const double minNoiseArea = 10.0;
 
-    for (size_t i = 0; i < contours.size(); i++)
+    // A hole contour runs through the centres of the pixels around the hole, so it encloses at
+    // least one pixel more than the hole itself. Holes this large always pass the noise filter.
+    const int minCountedHolePixels = static_cast<int>(minNoiseArea) - 1;
+
+    // Counts inner contours like findContours + the noise filter would, from the labeler stats
+    // alone. Returns -1 if a component is too small to decide without tracing it; hole is set to
+    // the last counted hole.
+    int countInnerContours(const ComponentLabeler &labeler, int &hole)
     {
-        double area = cv::contourArea(contours[i]);
-        if (area >= minNoiseArea)
+        int count = 0;
+        const auto &holes = labeler.holes();
+        for (int i = 0; i < static_cast<int>(holes.size()); i++)
         {
-            filteredContours.push_back(contours[i]);
-            if (i < hierarchy.size())
-            {
-                filteredHierarchy.push_back(hierarchy[i]);
-            }
+            if (holes[i].area < minCountedHolePixels)
+                return -1;
+            hole = i;
+            count++;
+        }
+
+        // Blobs inside holes are inner contours too. A contour never encloses more area than
+        // the pixels it surrounds, so small solid ones are noise for certain.
+        for (const auto &blob : labeler.blobs())
+        {
+            if (blob.parentHole >= 0 && (blob.holeCount > 0 || blob.area >= minNoiseArea))
+                return -1;
         }
+        return count;
     }
 
-    // Check if there are nested contours by examining the hierarchy
-    bool hasNestedContours = false;
-    std::vector<std::vector<cv::Point>> innerContours;
-    std::vector<int> parentIndices; // Store parent indices for inner contours
+    // True if any point of the contour is within two pixels of the ROI edge or outside the ROI
+    bool nearRoiBorder(const std::vector<cv::Point> &contour, const cv::Rect &roi)
+    {
+        const int borderThreshold = 2; // Pixels from border to consider as "touching"
+        for (const auto &point : contour)
+        {
+            // Convert point to ROI coordinates
+            int x = point.x - roi.x;
+            int y = point.y - roi.y;
+            if (x < borderThreshold || x >= roi.width - borderThreshold ||
+                y < borderThreshold || y >= roi.height - borderThreshold)
+                return true;
+        }
+        return false;
+    }
 
-    // Process hierarchy to find inner contours
-    for (size_t i = 0; i < filteredHierarchy.size(); i++)
+    // Shape metrics of a cell from its inner contour, and the ring ratio against the outer
+    // contour around it if there is one. Sets inRange and isValid when both are in range.
+    void measureCell(const std::vector<cv::Point> &innerContour, const std::vector<cv::Point> *outerContour,
+                     const ProcessingConfig &config, FilterResult &result, ContourWorkspace &ws)
     {
-        // h[3] > -1 means this contour has a parent (it's an inner contour)
-        if (filteredHierarchy[i][3] > -1)
+        // Calculate contour area of the original (non-hull) contour
+        double contourArea = cv::contourArea(innerContour);
+
+        // Hull area and perimeter in one go
+        const HullMetrics hullMetrics = convexHullMetrics(innerContour, ws);
+        double hullArea = hullMetrics.area;
+
+        // Calculate area ratio (R = Ahull/Acontour)
+        result.areaRatio = hullArea / contourArea;
+
+        double perimeter = hullMetrics.perimeter;
+
+        // Use the formula: sqrt(4 * pi * area) / perimeter
+        double circularity = (perimeter > 0) ? std::sqrt(4 * M_PI * hullArea) / perimeter : 0.0;
+        double deformability = 1.0 - circularity;
+
+        // Store metrics
+        result.deformability = deformability;
+        result.area = hullArea;
+
+        if (outerContour)
         {
-            hasNestedContours = true;
-            innerContours.push_back(filteredContours[i]);
-
-            // Store the index of the parent contour in the filtered contours array
-            int parentIdx = filteredHierarchy[i][3];
-            // Need to map from original hierarchy index to filtered index
-            int filteredParentIdx = -1;
-            for (size_t j = 0; j < filteredContours.size(); j++)
-            {
-                if (j == parentIdx)
-                {
-                    filteredParentIdx = j;
-                    break;
-                }
-            }
-            parentIndices.push_back(filteredParentIdx);
+            // Calculate the ring ratio using the inner contour and its parent outer contour
+            result.ringRatio = calculateRingRatio(innerContour, *outerContour);
+        }
+
+        // Check area range only if that check is enabled
+        bool areaInRange = !config.enable_area_range_check ||
+                           (hullArea >= config.area_threshold_min && hullArea <= config.area_threshold_max);
+
+        // Check ring ratio range (13 < ringRatio < 25) - TODO: move these values to config.json
+        bool ringRatioInRange = (result.ringRatio > 15.0 && result.ringRatio < 25.0);
+
+        if (areaInRange && ringRatioInRange)
+        {
+            result.inRange = true;
+            // Set isValid to true for frames with exactly one inner contour and valid ring ratio
+            result.isValid = true;
+        }
+    }
+}
+
+void findContours(const cv::Mat &processedImage, const cv::Point &offset, ContourWorkspace &ws)
+{
+    cv::findContours(processedImage, ws.contours, ws.hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE, offset);
+
+    // Filter out small noise contours
+    ws.kept.clear();
+    ws.inner.clear();
+    ws.parents.clear();
+    for (size_t i = 0; i < ws.contours.size(); i++)
+    {
+        if (cv::contourArea(ws.contours[i]) >= minNoiseArea)
+        {
+            ws.kept.push_back(static_cast<int>(i));
         }
     }
 
-    return std::make_tuple(filteredContours, hasNestedContours, innerContours, parentIndices);
+    // h[3] > -1 means this contour has a parent (it's an inner contour)
+    for (size_t i = 0; i < ws.kept.size(); i++)
+    {
+        const int parentIdx = ws.hierarchy[ws.kept[i]][3];
+        if (parentIdx > -1)
+        {
+            ws.inner.push_back(ws.kept[i]);
+            // The parent index is taken as a position among the kept contours, as it always was
+            ws.parents.push_back(parentIdx < static_cast<int>(ws.kept.size()) ? parentIdx : -1);
+        }
+    }
 }
 
-std::tuple<double, double> calculateMetrics(const std::vector<cv::Point> &contour)
+std::tuple<std::vector<std::vector<cv::Point>>, bool, std::vector<std::vector<cv::Point>>, std::vector<int>> findContours(const cv::Mat &processedImage, const cv::Point &offset)
 {
-    // Calculate convex hull first
-    std::vector<cv::Point> hull;
-    cv::convexHull(contour, hull);
+    ContourWorkspace ws;
+    findContours(processedImage, offset, ws);
 
+    std::vector<std::vector<cv::Point>> filteredContours;
+    std::vector<std::vector<cv::Point>> innerContours;
+    for (int index : ws.kept)
+    {
+        filteredContours.push_back(ws.contours[index]);
+    }
+    for (int index : ws.inner)
+    {
+        innerContours.push_back(ws.contours[index]);
+    }
+    const bool hasNestedContours = !innerContours.empty();
+    return std::make_tuple(filteredContours, hasNestedContours, innerContours, ws.parents);
+}
+
+std::tuple<double, double> calculateMetrics(const std::vector<cv::Point> &contour)
+{
     // Use hull for both area and perimeter calculations
-    double area = cv::contourArea(hull);
-    double perimeter = cv::arcLength(hull, true);
+    const HullMetrics hull = convexHullMetrics(contour, threadContourWorkspace());
+    double area = hull.area;
+    double perimeter = hull.perimeter;
 
     // Updated formula: sqrt(4 * pi * area) / perimeter
     double circularity = (perimeter > 0) ? std::sqrt(4 * M_PI * area) / perimeter : 0.0; // DO NOT CHANGE THIS FORMULA
@@ -155,199 +363,135 @@ std::tuple<double, double> calculateMetrics(const std::vector<cv::Point> &contou
 
 FilterResult filterProcessedImage(const cv::Mat &processedImage, const cv::Rect &roi,
                                   const ProcessingConfig &config, const uint8_t processedColor,
-                                  const cv::Mat &originalImage)
+                                  const cv::Mat &originalImage, cv::Rect *objectBox)
 {
     // Initialize result with default values
     // isValid is now false by default, will be set to true if criteria are met
     FilterResult result = {false, false, false, false, 0, 0.0, 0.0, 0.0, 0.0, BrightnessQuantiles()};
 
-    // Get ROI from processed image
-    cv::Mat roiImage = processedImage(roi);
-
-    // First, find contours in the entire processed image
-    auto [contours, hasNestedContours, innerContours, parentIndices] = findContours(processedImage);
-
-    // Update inner contour information
-    result.innerContourCount = static_cast<int>(innerContours.size());
-    result.hasSingleInnerContour = (innerContours.size() == 1);
-
-    // Calculate brightness quantiles if the original image is provided
-    if (!originalImage.empty())
+    // Everything outside the ROI is zero, so only the ROI is searched. Contours come back in
+    // frame coordinates.
+    const cv::Rect area = roi & cv::Rect(0, 0, processedImage.cols, processedImage.rows);
+    cv::Mat roiImage = processedImage(area);
+
+    // Contours live in the thread's workspace and are referred to by index: kept is the noise
+    // filtered list, inner the inner contours and parents their outer contour's position in kept
+    ContourWorkspace &ws = threadContourWorkspace();
+    const auto contour = [&ws](int index) -> const std::vector<cv::Point> &
+    { return ws.contours[index]; };
+    bool labeled = false;
+    if (config.component_analysis && config.require_single_inner_contour)
+    {
+        // Only the blob around the single hole gets traced, every other frame is decided from
+        // the run statistics
+        thread_local ComponentLabeler labeler;
+        labeler.label(roiImage);
+        int hole = -1;
+        const int count = countInnerContours(labeler, hole);
+        if (count >= 0)
+        {
+            labeled = true;
+            result.innerContourCount = count;
+            ws.kept.clear();
+            ws.inner.clear();
+            ws.parents.clear();
+            if (count == 1)
+            {
+                labeler.traceBlob(labeler.holes()[hole].owner, area.tl(), ws.contours, ws.hierarchy, ws.mask);
+                for (size_t i = 0; i < ws.contours.size(); i++)
+                {
+                    if (ws.hierarchy[i][3] < 0)
+                        ws.kept.push_back(static_cast<int>(i));
+                    else
+                        ws.inner.push_back(static_cast<int>(i));
+                }
+                ws.parents.push_back(0);
+            }
+        }
+    }
+    if (!labeled)
     {
-        result.brightness = calculateBrightnessQuantiles(originalImage, processedImage);
+        findContours(roiImage, area.tl(), ws);
+        result.innerContourCount = static_cast<int>(ws.inner.size());
     }
 
+    // Update inner contour information
+    result.hasSingleInnerContour = (result.innerContourCount == 1);
+
     // If we require a single inner contour and don't have exactly one, return early
     if (config.require_single_inner_contour && !result.hasSingleInnerContour)
     {
         // For simplicity, we only process objects with exactly one inner contour
+        settleContourWorkspace(ws);
         return result;
     }
 
     // Border check using contours instead of raw pixels
     if (config.enable_border_check)
     {
-        const int borderThreshold = 2; // Pixels from border to consider as "touching"
-
         // If we have inner contours, check if the inner contour touches the border
-        if (!innerContours.empty())
+        if (!ws.inner.empty())
         {
             // We only care about the first inner contour (we've already checked for single inner contour above)
-            const auto &innerContour = innerContours[0];
-
-            // Check if any point of the inner contour is too close to the border
-            for (const auto &point : innerContour)
-            {
-                // Convert point to ROI coordinates
-                int x = point.x - roi.x;
-                int y = point.y - roi.y;
-
-                // Check if point is within the ROI (safety check)
-                if (x >= 0 && x < roi.width && y >= 0 && y < roi.height)
-                {
-                    // Check if point is too close to any border
-                    if (x < borderThreshold || x >= roi.width - borderThreshold ||
-                        y < borderThreshold || y >= roi.height - borderThreshold)
-                    {
-                        result.touchesBorder = true;
-                        break;
-                    }
-                }
-                else
-                {
-                    // Point is outside ROI, definitely touching border
-                    result.touchesBorder = true;
-                    break;
-                }
-            }
+            result.touchesBorder = nearRoiBorder(contour(ws.inner[0]), roi);
         }
-        else if (!contours.empty())
+        else
         {
             // If no inner contours, check outer contours
-            for (const auto &contour : contours)
-            {
-                // Check if any point of the contour is too close to the border
-                for (const auto &point : contour)
-                {
-                    // Convert point to ROI coordinates
-                    int x = point.x - roi.x;
-                    int y = point.y - roi.y;
-
-                    // Check if point is within the ROI (safety check)
-                    if (x >= 0 && x < roi.width && y >= 0 && y < roi.height)
-                    {
-                        // Check if point is too close to any border
-                        if (x < borderThreshold || x >= roi.width - borderThreshold ||
-                            y < borderThreshold || y >= roi.height - borderThreshold)
-                        {
-                            result.touchesBorder = true;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        // Point is outside ROI, definitely touching border
-                        result.touchesBorder = true;
-                        break;
-                    }
-                }
-
-                if (result.touchesBorder)
-                {
-                    break; // No need to check other contours
-                }
-            }
+            result.touchesBorder = std::any_of(ws.kept.begin(), ws.kept.end(), [&](int index)
+                                               { return nearRoiBorder(contour(index), roi); });
         }
     }
 
+    // Bounding box of the object the metrics describe, frame coordinates
+    cv::Rect box;
+
     // Only proceed with contour analysis if no border pixels were found or border check is disabled
     if (!result.touchesBorder || !config.enable_border_check)
     {
         // If we have a single inner contour, use it for metrics
         if (result.hasSingleInnerContour)
         {
-            // We have exactly one inner contour - use it for metrics
-            // Calculate contour area of the original (non-hull) contour
-            double contourArea = cv::contourArea(innerContours[0]);
-
-            // Calculate convex hull once
-            std::vector<cv::Point> hull;
-            cv::convexHull(innerContours[0], hull);
-
-            // Get the hull area
-            double hullArea = cv::contourArea(hull);
-
-            // Calculate area ratio (R = Ahull/Acontour)
-            result.areaRatio = hullArea / contourArea;
-
-            // Calculate perimeter of the hull
-            double perimeter = cv::arcLength(hull, true);
-
-            // Use the formula: sqrt(4 * pi * area) / perimeter
-            double circularity = (perimeter > 0) ? std::sqrt(4 * M_PI * hullArea) / perimeter : 0.0;
-            double deformability = 1.0 - circularity;
-
-            // Store metrics
-            result.deformability = deformability;
-            result.area = hullArea;
-
-            // Calculate ring ratio using the parent contour information
-            if (parentIndices.size() > 0)
-            {
-                int parentIdx = parentIndices[0];
-                if (parentIdx >= 0 && parentIdx < contours.size())
-                {
-                    // Calculate the ring ratio using the inner contour and its parent outer contour
-                    result.ringRatio = calculateRingRatio(innerContours[0], contours[parentIdx]);
-                }
-            }
-
-            // Check area range only if that check is enabled
-            bool areaInRange = !config.enable_area_range_check ||
-                               (hullArea >= config.area_threshold_min && hullArea <= config.area_threshold_max);
-
-            // Check ring ratio range (13 < ringRatio < 25) - TODO: move these values to config.json
-            bool ringRatioInRange = (result.ringRatio > 15.0 && result.ringRatio < 25.0);
-
-            if (areaInRange && ringRatioInRange)
-            {
-                result.inRange = true;
-                // Set isValid to true for frames with exactly one inner contour and valid ring ratio
-                result.isValid = true;
-            }
+            // We have exactly one inner contour - use it for metrics, with the ring ratio
+            // against its parent outer contour
+            const std::vector<cv::Point> &innerContour = contour(ws.inner[0]);
+            const int parentIdx = ws.parents.empty() ? -1 : ws.parents[0];
+            const bool hasParent = parentIdx >= 0 && parentIdx < static_cast<int>(ws.kept.size());
+            const std::vector<cv::Point> *outerContour = hasParent ? &contour(ws.kept[parentIdx]) : nullptr;
+            measureCell(innerContour, outerContour, config, result, ws);
+            box = cv::boundingRect(outerContour ? *outerContour : innerContour);
         }
         // If no inner contours but we have contours, use the largest one
-        else if (!contours.empty() && !config.require_single_inner_contour)
+        else if (!ws.kept.empty() && !config.require_single_inner_contour)
         {
             // Find the largest contour
-            size_t largestIdx = 0;
+            int largestIdx = ws.kept[0];
             double largestOuterArea = 0.0;
 
-            for (size_t i = 0; i < contours.size(); i++)
+            for (int index : ws.kept)
             {
-                double area = cv::contourArea(contours[i]);
+                double area = cv::contourArea(contour(index));
                 if (area > largestOuterArea)
                 {
                     largestOuterArea = area;
-                    largestIdx = i;
+                    largestIdx = index;
                 }
             }
+            const std::vector<cv::Point> &largest = contour(largestIdx);
 
-            // Calculate contour area of the original (non-hull) contour
-            double contourArea = cv::contourArea(contours[largestIdx]);
+            box = cv::boundingRect(largest);
 
-            // Calculate convex hull once
-            std::vector<cv::Point> hull;
-            cv::convexHull(contours[largestIdx], hull);
+            // Calculate contour area of the original (non-hull) contour
+            double contourArea = cv::contourArea(largest);
 
-            // Get the hull area
-            double hullArea = cv::contourArea(hull);
+            // Hull area and perimeter in one go
+            const HullMetrics hullMetrics = convexHullMetrics(largest, ws);
+            double hullArea = hullMetrics.area;
 
             // Calculate area ratio (R = Ahull/Acontour)
             result.areaRatio = hullArea / contourArea;
 
-            // Calculate perimeter of the hull
-            double perimeter = cv::arcLength(hull, true);
+            double perimeter = hullMetrics.perimeter;
 
             // Use the formula: sqrt(4 * pi * area) / perimeter
             double circularity = (perimeter > 0) ? std::sqrt(4 * M_PI * hullArea) / perimeter : 0.0;
@@ -367,9 +511,131 @@ FilterResult filterProcessedImage(const cv::Mat &processedImage, const cv::Rect
         }
     }
 
+    // Brightness quantiles only for frames that pass, read from the object's box alone
+    box &= area;
+    if (objectBox)
+        *objectBox = box;
+    if (result.isValid && !originalImage.empty())
+    {
+        result.brightness = calculateBrightnessQuantiles(originalImage(box), processedImage(box));
+    }
+
+    settleContourWorkspace(ws);
     return result;
 }
 
+FilterResult analyzeObjects(const cv::Mat &processedImage, const cv::Rect &roi, const ProcessingConfig &config,
+                            const cv::Mat &originalImage, std::vector<ObjectResult> &objects)
+{
+    FilterResult frameResult = {false, false, false, false, 0, 0.0, 0.0, 0.0, 0.0, BrightnessQuantiles()};
+    objects.clear();
+
+    const cv::Rect area = roi & cv::Rect(0, 0, processedImage.cols, processedImage.rows);
+    thread_local ComponentLabeler labeler;
+    labeler.label(processedImage(area));
+
+    // A cell is a ring: a top level blob with a hole. Blobs inside a hole belong to the cell
+    // around it and are left out when it is traced.
+    // Per-frame lists live in this thread's workspace, measure() only uses the scratch of the thread it runs on
+    ContourWorkspace &frameWs = threadContourWorkspace();
+    std::vector<int> &candidates = frameWs.candidates;
+    candidates.clear();
+    const auto &blobs = labeler.blobs();
+    for (int i = 0; i < static_cast<int>(blobs.size()); i++)
+    {
+        if (blobs[i].parentHole < 0 && blobs[i].holeCount > 0)
+            candidates.push_back(i);
+    }
+
+    std::vector<ObjectResult> &measured = frameWs.measured;
+    measured.clear();
+    measured.resize(candidates.size());
+    auto measure = [&](int index)
+    {
+        FilterResult &result = measured[index].result;
+        result = frameResult;
+
+        // parallel_for_ runs this on several threads, each with its own workspace
+        ContourWorkspace &ws = threadContourWorkspace();
+        std::vector<std::vector<cv::Point>> &contours = ws.contours;
+        std::vector<cv::Vec4i> &hierarchy = ws.hierarchy;
+        labeler.traceBlob(candidates[index], area.tl(), contours, hierarchy, ws.mask);
+
+        // The same noise filter as findContours, only holes above it count
+        const std::vector<cv::Point> *outerContour = nullptr;
+        const std::vector<cv::Point> *innerContour = nullptr;
+        for (size_t i = 0; i < contours.size(); i++)
+        {
+            if (hierarchy[i][3] < 0)
+            {
+                outerContour = &contours[i];
+            }
+            else if (cv::contourArea(contours[i]) >= minNoiseArea)
+            {
+                innerContour = &contours[i];
+                result.innerContourCount++;
+            }
+        }
+        result.hasSingleInnerContour = result.innerContourCount == 1;
+        result.touchesBorder = result.hasSingleInnerContour && outerContour && config.enable_border_check &&
+                               nearRoiBorder(*innerContour, roi);
+        if (!result.hasSingleInnerContour || !outerContour || result.touchesBorder)
+        {
+            settleContourWorkspace(ws);
+            return;
+        }
+
+        measureCell(*innerContour, outerContour, config, result, ws);
+        const cv::Rect box = cv::boundingRect(*outerContour) & area;
+        if (result.isValid && !originalImage.empty())
+        {
+            result.brightness = calculateBrightnessQuantiles(originalImage(box), processedImage(box));
+        }
+
+        const int margin = std::max(0, config.object_crop_margin);
+        measured[index].cellBox = box;
+        measured[index].box = cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin, box.height + 2 * margin) & area;
+        settleContourWorkspace(ws);
+    };
+
+    // Tracing and hull metrics dominate a crowded frame, spread them over OpenCV's thread pool
+    const int count = static_cast<int>(candidates.size());
+    if (count >= std::max(2, config.parallel_objects_min))
+    {
+        cv::parallel_for_(cv::Range(0, count), [&](const cv::Range &range)
+                          {
+                              for (int i = range.start; i < range.end; i++)
+                              {
+                                  measure(i);
+                              } });
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+        {
+            measure(i);
+        }
+    }
+
+    for (auto &object : measured)
+    {
+        frameResult.innerContourCount += object.result.innerContourCount;
+        if (object.result.isValid)
+            objects.push_back(std::move(object));
+    }
+
+    // The frame reads like its first valid cell, or like the first cell that failed
+    const int innerContourCount = frameResult.innerContourCount;
+    if (!objects.empty())
+        frameResult = objects.front().result;
+    else if (!measured.empty())
+        frameResult = measured.front().result;
+    frameResult.innerContourCount = innerContourCount;
+    frameResult.hasSingleInnerContour = innerContourCount == 1;
+    settleContourWorkspace(frameWs);
+    return frameResult;
+}
+
 cv::Scalar determineOverlayColor(const FilterResult &result, bool isValid)
 {
     // Hierarchical condition checking based solely on FilterResult
@@ -409,46 +675,61 @@ BrightnessQuantiles calculateBrightnessQuantiles(const cv::Mat &originalImage, c
     }
     else
     {
-        grayImage = originalImage.clone();
+        grayImage = originalImage; // Only read
     }
 
-    // Extract brightness values from the masked area
-    std::vector<uchar> brightness;
-    brightness.reserve(grayImage.rows * grayImage.cols / 4); // Approximate size
-
+    // Histogram of the masked pixels. Four interleaved tables keep consecutive increments of
+    // the same bin from waiting on each other; masked-out pixels add zero instead of branching.
+    uint32_t histograms[4][256] = {};
     for (int y = 0; y < grayImage.rows; y++)
     {
-        for (int x = 0; x < grayImage.cols; x++)
+        const uchar *pixels = grayImage.ptr<uchar>(y);
+        const uchar *maskRow = mask.ptr<uchar>(y);
+        int x = 0;
+        for (; x + 8 <= grayImage.cols; x += 8)
         {
-            // Check if this pixel is part of the mask
-            if (mask.at<uchar>(y, x) > 0)
+            uint64_t maskWord;
+            std::memcpy(&maskWord, maskRow + x, sizeof(maskWord));
+            if (maskWord == 0)
+                continue; // Background around the object
+            for (int i = 0; i < 8; i++)
             {
-                brightness.push_back(grayImage.at<uchar>(y, x));
+                histograms[i & 3][pixels[x + i]] += maskRow[x + i] != 0;
             }
         }
+        for (; x < grayImage.cols; x++)
+        {
+            histograms[0][pixels[x]] += maskRow[x] != 0;
+        }
+    }
+
+    uint32_t histogram[256];
+    size_t n = 0;
+    for (int value = 0; value < 256; value++)
+    {
+        histogram[value] = histograms[0][value] + histograms[1][value] + histograms[2][value] + histograms[3][value];
+        n += histogram[value];
     }
 
     // If no masked pixels were found, return zeros
-    if (brightness.empty())
+    if (n == 0)
     {
         return result;
     }
 
-    // Sort the values to compute quantiles
-    std::sort(brightness.begin(), brightness.end());
-
-    // Calculate quantile positions
-    size_t n = brightness.size();
-    size_t q1_pos = n / 4;
-    size_t q2_pos = n / 2;
-    size_t q3_pos = (3 * n) / 4;
-    size_t q4_pos = n - 1;
-
-    // Extract quantile values
-    result.q1 = brightness[q1_pos];
-    result.q2 = brightness[q2_pos];
-    result.q3 = brightness[q3_pos];
-    result.q4 = brightness[q4_pos];
+    // The quantiles are the values at these ranks of the sorted pixels
+    const size_t positions[4] = {n / 4, n / 2, (3 * n) / 4, n - 1};
+    double *quantiles[4] = {&result.q1, &result.q2, &result.q3, &result.q4};
+    size_t cumulative = 0;
+    int next = 0;
+    for (int value = 0; value < 256 && next < 4; value++)
+    {
+        cumulative += histogram[value];
+        while (next < 4 && positions[next] < cumulative)
+        {
+            *quantiles[next++] = value;
+        }
+    }
 
     return result;
 }
\ No newline at end of file
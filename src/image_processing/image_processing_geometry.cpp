@@ -0,0 +1,103 @@
+#include "image_processing/image_processing.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+    std::atomic<uint64_t> bufferGrowths{0};
+
+    // Twice the signed area of the triangle a, b, c: positive for a left turn
+    int64_t cross(const cv::Point &a, const cv::Point &b, const cv::Point &c)
+    {
+        return static_cast<int64_t>(b.x - a.x) * (c.y - a.y) - static_cast<int64_t>(b.y - a.y) * (c.x - a.x);
+    }
+
+    // Bytes held by the workspace buffers
+    size_t footprint(const ContourWorkspace &ws)
+    {
+        size_t bytes = ws.contours.capacity() * sizeof(std::vector<cv::Point>);
+        for (const auto &contour : ws.contours)
+        {
+            bytes += contour.capacity() * sizeof(cv::Point);
+        }
+        bytes += ws.hierarchy.capacity() * sizeof(cv::Vec4i);
+        bytes += (ws.kept.capacity() + ws.inner.capacity() + ws.parents.capacity() + ws.candidates.capacity()) * sizeof(int);
+        bytes += ws.measured.capacity() * sizeof(ObjectResult);
+        bytes += (ws.sorted.capacity() + ws.hull.capacity()) * sizeof(cv::Point);
+        bytes += static_cast<size_t>(ws.mask.dataend - ws.mask.datastart);
+        return bytes;
+    }
+}
+
+ContourWorkspace &threadContourWorkspace()
+{
+    thread_local ContourWorkspace workspace;
+    return workspace;
+}
+
+void settleContourWorkspace(ContourWorkspace &ws)
+{
+    const size_t bytes = footprint(ws);
+    if (bytes != ws.footprint)
+    {
+        // A buffer shrinking is fine, the next frame that needs it back allocates and counts
+        if (bytes > ws.footprint)
+            bufferGrowths.fetch_add(1, std::memory_order_relaxed);
+        ws.footprint = bytes;
+    }
+}
+
+uint64_t contourBufferGrowths()
+{
+    return bufferGrowths.load(std::memory_order_relaxed);
+}
+
+// Andrew's monotone chain. Our contours are CHAIN_APPROX_SIMPLE polygons of a few dozen points,
+// where sorting a copy is cheaper than anything cleverer. Collinear points are dropped, which
+// changes neither the area nor the perimeter.
+HullMetrics convexHullMetrics(const std::vector<cv::Point> &points, ContourWorkspace &ws)
+{
+    std::vector<cv::Point> &sorted = ws.sorted;
+    std::vector<cv::Point> &hull = ws.hull;
+    sorted.assign(points.begin(), points.end());
+    std::sort(sorted.begin(), sorted.end(), [](const cv::Point &a, const cv::Point &b)
+              { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+
+    const size_t n = sorted.size();
+    if (n < 2)
+    {
+        hull.assign(sorted.begin(), sorted.end());
+        return HullMetrics();
+    }
+
+    hull.resize(2 * n);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0)
+            k--;
+        hull[k++] = sorted[i];
+    }
+    for (size_t i = n - 1, lower = k + 1; i > 0; i--)
+    {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], sorted[i - 1]) <= 0)
+            k--;
+        hull[k++] = sorted[i - 1];
+    }
+    hull.resize(k - 1); // The chain ends where it started
+
+    // Shoelace area and closed perimeter in one pass. Edge lengths are taken in float like
+    // cv::arcLength does, so the deformability comes out as before.
+    HullMetrics metrics;
+    int64_t twiceArea = 0;
+    for (size_t i = 0, j = hull.size() - 1; i < hull.size(); j = i++)
+    {
+        twiceArea += static_cast<int64_t>(hull[j].x) * hull[i].y - static_cast<int64_t>(hull[i].x) * hull[j].y;
+        const float dx = static_cast<float>(hull[i].x - hull[j].x);
+        const float dy = static_cast<float>(hull[i].y - hull[j].y);
+        metrics.perimeter += std::sqrt(dx * dx + dy * dy);
+    }
+    metrics.area = std::abs(static_cast<double>(twiceArea)) * 0.5;
+    return metrics;
+}
@@ -0,0 +1,534 @@
+#include "image_processing/image_processing.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstring>
+
+// The function forms of the universal intrinsics (v_add, v_gt, ...) exist from OpenCV 4.8 on
+#if (CV_SIMD || CV_SIMD_SCALABLE) && (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 8))
+#define MIB_FUSED_SIMD 1
+#else
+#define MIB_FUSED_SIMD 0
+#endif
+
+namespace
+{
+    // cv::BORDER_REFLECT_101, what GaussianBlur uses at the image edges
+    int reflect101(int p, int length)
+    {
+        if (length == 1)
+            return 0;
+        while (p < 0 || p >= length)
+        {
+            p = p < 0 ? -p : 2 * length - 2 - p;
+        }
+        return p;
+    }
+
+    // Binomial taps of the 8-bit GaussianBlur for sigma 0: 1 2 1 (sum 4) and 1 4 6 4 1 (sum 16).
+    // OpenCV blurs 8-bit images in fixed point with exactly these weights and rounds half up,
+    // so the integer sums below reproduce its output bit for bit.
+    template <int Radius>
+    void horizontalPass(const uint8_t *padded, uint16_t *out, int width)
+    {
+        int x = 0;
+#if MIB_FUSED_SIMD
+        const int lanes = cv::VTraits<cv::v_uint16>::vlanes();
+        for (; x <= width - lanes; x += lanes)
+        {
+            const uint8_t *p = padded + x;
+            cv::v_uint16 sum;
+            if (Radius == 1)
+            {
+                sum = cv::v_add(cv::v_add(cv::vx_load_expand(p), cv::vx_load_expand(p + 2)),
+                                cv::v_shl<1>(cv::vx_load_expand(p + 1)));
+            }
+            else
+            {
+                const cv::v_uint16 centre = cv::vx_load_expand(p + 2);
+                sum = cv::v_add(cv::v_add(cv::vx_load_expand(p), cv::vx_load_expand(p + 4)),
+                                cv::v_shl<2>(cv::v_add(cv::vx_load_expand(p + 1), cv::vx_load_expand(p + 3))));
+                sum = cv::v_add(sum, cv::v_add(cv::v_shl<2>(centre), cv::v_shl<1>(centre)));
+            }
+            cv::v_store(out + x, sum);
+        }
+#endif
+        for (; x < width; x++)
+        {
+            const uint8_t *p = padded + x;
+            if (Radius == 1)
+                out[x] = static_cast<uint16_t>(p[0] + 2 * p[1] + p[2]);
+            else
+                out[x] = static_cast<uint16_t>(p[0] + 4 * p[1] + 6 * p[2] + 4 * p[3] + p[4]);
+        }
+    }
+
+    // Vertical pass, rounding, saturating background subtraction and threshold for one row
+    template <int Radius>
+    void verticalPass(const uint16_t *const *rows, const uint8_t *background, uint8_t *binary, int width, int threshold)
+    {
+        constexpr int Shift = Radius == 1 ? 4 : 8;
+        constexpr int Half = 1 << (Shift - 1);
+        int x = 0;
+#if MIB_FUSED_SIMD
+        // Sums stay within 16 bits: 255 * 256 + 128 for the 5x5 kernel
+        const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+        const int halfLanes = cv::VTraits<cv::v_uint16>::vlanes();
+        const cv::v_uint16 half = cv::vx_setall_u16(static_cast<uint16_t>(Half));
+        const cv::v_uint16 limit = cv::vx_setall_u16(static_cast<uint16_t>(std::clamp(threshold, -1, 255) + 1));
+        auto mask = [&](int at)
+        {
+            cv::v_uint16 sum;
+            if (Radius == 1)
+            {
+                sum = cv::v_add(cv::v_add(cv::vx_load(rows[0] + at), cv::vx_load(rows[2] + at)),
+                                cv::v_shl<1>(cv::vx_load(rows[1] + at)));
+            }
+            else
+            {
+                const cv::v_uint16 centre = cv::vx_load(rows[2] + at);
+                sum = cv::v_add(cv::v_add(cv::vx_load(rows[0] + at), cv::vx_load(rows[4] + at)),
+                                cv::v_shl<2>(cv::v_add(cv::vx_load(rows[1] + at), cv::vx_load(rows[3] + at))));
+                sum = cv::v_add(sum, cv::v_add(cv::v_shl<2>(centre), cv::v_shl<1>(centre)));
+            }
+            const cv::v_uint16 blurred = cv::v_shr<Shift>(cv::v_add(sum, half));
+            // v_sub saturates for 16-bit lanes, like cv::subtract on 8-bit images
+            const cv::v_uint16 difference = cv::v_sub(blurred, cv::vx_load_expand(background + at));
+            // difference > threshold, written as >= threshold + 1 to stay unsigned
+            return cv::v_ge(difference, limit);
+        };
+        for (; x <= width - lanes; x += lanes)
+        {
+            cv::v_store(binary + x, cv::v_pack(mask(x), mask(x + halfLanes)));
+        }
+#endif
+        for (; x < width; x++)
+        {
+            int sum;
+            if (Radius == 1)
+                sum = rows[0][x] + 2 * rows[1][x] + rows[2][x];
+            else
+                sum = rows[0][x] + 4 * (rows[1][x] + rows[3][x]) + 6 * rows[2][x] + rows[4][x];
+            const int blurred = (sum + Half) >> Shift;
+            const int difference = std::max(blurred - background[x], 0);
+            binary[x] = difference > threshold ? 255 : 0;
+        }
+    }
+
+    // Adds one written mask row (0/255) to the stats. The row is still in cache and mostly
+    // background, so it is skipped eight pixels at a time.
+    void accumulateForeground(const uint8_t *row, int width, int y, ForegroundStats &foreground)
+    {
+        int count = 0;
+        int first = -1;
+        int last = -1;
+        for (int x = 0; x < width;)
+        {
+            uint64_t word;
+            if (x + 8 <= width && (std::memcpy(&word, row + x, sizeof(word)), word == 0))
+            {
+                x += 8;
+                continue;
+            }
+            const int end = std::min(x + 8, width);
+            for (; x < end; x++)
+            {
+                if (!row[x])
+                    continue;
+                count++;
+                if (first < 0)
+                    first = x;
+                last = x;
+            }
+        }
+        if (count == 0)
+            return;
+        const cv::Rect extent(first, y, last - first + 1, 1);
+        foreground.bbox = foreground.pixels ? (foreground.bbox | extent) : extent;
+        foreground.pixels += count;
+    }
+
+    template <int Radius>
+    void blurSubtractThreshold(const cv::Mat &image, const cv::Rect &roi, const cv::Mat &blurredBackground,
+                               int threshold, cv::Mat &binary, ThreadLocalMats &mats, ForegroundStats *foreground)
+    {
+        constexpr int Taps = 2 * Radius + 1;
+        const int width = roi.width;
+        const int paddedWidth = width + 2 * Radius;
+
+        mats.paddedRow.resize(static_cast<size_t>(paddedWidth));
+        mats.blurRows.resize(static_cast<size_t>(Taps) * width);
+
+        // Horizontal sums of source rows y - Radius .. y + Radius, kept in a ring of Taps rows.
+        // Like GaussianBlur on an ROI view, pixels outside the ROI come from the surrounding
+        // image and only the image edges are reflected.
+        auto loadRow = [&](int sourceY, uint16_t *out)
+        {
+            const uint8_t *row = image.ptr<uint8_t>(reflect101(sourceY, image.rows));
+            uint8_t *padded = mats.paddedRow.data();
+            const int left = roi.x - Radius;
+            if (left >= 0 && roi.x + width + Radius <= image.cols)
+            {
+                horizontalPass<Radius>(row + left, out, width);
+                return;
+            }
+            for (int x = 0; x < paddedWidth; x++)
+            {
+                padded[x] = row[reflect101(left + x, image.cols)];
+            }
+            horizontalPass<Radius>(padded, out, width);
+        };
+        auto ringRow = [&](int sourceY)
+        {
+            const int slot = ((sourceY - roi.y + Radius) % Taps + Taps) % Taps;
+            return mats.blurRows.data() + static_cast<size_t>(slot) * width;
+        };
+
+        for (int sourceY = roi.y - Radius; sourceY < roi.y + Radius; sourceY++)
+        {
+            loadRow(sourceY, ringRow(sourceY));
+        }
+
+        const uint16_t *rows[Taps];
+        for (int y = roi.y; y < roi.y + roi.height; y++)
+        {
+            loadRow(y + Radius, ringRow(y + Radius));
+            for (int tap = 0; tap < Taps; tap++)
+            {
+                rows[tap] = ringRow(y - Radius + tap);
+            }
+            uint8_t *out = binary.ptr<uint8_t>(y) + roi.x;
+            verticalPass<Radius>(rows, blurredBackground.ptr<uint8_t>(y) + roi.x, out, width, threshold);
+            if (foreground)
+                accumulateForeground(out, width, y - roi.y, *foreground);
+        }
+    }
+
+    template <int Radius>
+    bool fixedBlurSubtractThreshold(const cv::Mat &image, const cv::Rect &roi, const cv::Mat &blurredBackground,
+                                    int threshold, cv::Mat &binary, ThreadLocalMats &mats, ForegroundStats *foreground)
+    {
+        if (image.type() != CV_8UC1 || blurredBackground.type() != CV_8UC1 || binary.type() != CV_8UC1 ||
+            blurredBackground.size() != image.size() || binary.size() != image.size() || roi.empty())
+            return false;
+
+        if (foreground)
+            *foreground = ForegroundStats();
+        blurSubtractThreshold<Radius>(image, roi, blurredBackground, threshold, binary, mats, foreground);
+        return true;
+    }
+}
+
+void countForeground(const cv::Mat &binary, const cv::Rect &roi, ForegroundStats &foreground)
+{
+    foreground = ForegroundStats();
+    for (int y = 0; y < roi.height; y++)
+    {
+        accumulateForeground(binary.ptr<uint8_t>(roi.y + y) + roi.x, roi.width, y, foreground);
+    }
+}
+
+namespace
+{
+    // One bit per pixel, bit b of word k in a row is pixel 64 * k + b
+    struct PackedPlane
+    {
+        uint64_t *words;
+        int rows;
+        int width;
+        int wordsPerRow;
+
+        uint64_t *row(int y) const { return words + static_cast<size_t>(y) * wordsPerRow; }
+    };
+
+    // A structuring element row whose set pixels form one run, offsets relative to the anchor
+    struct KernelRun
+    {
+        int dy;
+        int first;
+        int last;
+    };
+
+    struct KernelRuns
+    {
+        KernelRun runs[64];
+        int count = 0;
+
+        const KernelRun *begin() const { return runs; }
+        const KernelRun *end() const { return runs + count; }
+    };
+
+    bool kernelRuns(const cv::Mat &kernel, KernelRuns &runs)
+    {
+        if (kernel.type() != CV_8UC1 || kernel.cols >= 64 || kernel.rows >= 64)
+            return false;
+        const int anchorX = kernel.cols / 2;
+        const int anchorY = kernel.rows / 2;
+        for (int i = 0; i < kernel.rows; i++)
+        {
+            const uint8_t *row = kernel.ptr<uint8_t>(i);
+            int first = -1;
+            int last = -1;
+            for (int j = 0; j < kernel.cols; j++)
+            {
+                if (!row[j])
+                    continue;
+                if (first >= 0 && last != j - 1)
+                    return false; // Gaps need a run per segment, not worth it for cross/rect/ellipse
+                if (first < 0)
+                    first = j;
+                last = j;
+            }
+            if (first >= 0)
+                runs.runs[runs.count++] = {i - anchorY, first - anchorX, last - anchorX};
+        }
+        return runs.count > 0;
+    }
+
+    // Word k of a row shifted so that bit x holds pixel x + dx, pixels beyond the row read as fill
+    inline uint64_t shiftedWord(const uint64_t *row, int k, int words, int dx, uint64_t fill)
+    {
+        if (dx == 0)
+            return row[k];
+        if (dx > 0)
+        {
+            const uint64_t next = k + 1 < words ? row[k + 1] : fill;
+            return (row[k] >> dx) | (next << (64 - dx));
+        }
+        const uint64_t previous = k > 0 ? row[k - 1] : fill;
+        return (row[k] << -dx) | (previous >> (64 + dx));
+    }
+
+    // Sets the padding bits past the ROI width to the fill value of the coming pass
+    template <bool Dilate>
+    void fillPadding(const PackedPlane &source)
+    {
+        const uint64_t fill = Dilate ? 0 : ~uint64_t(0);
+        const int tailBits = source.width % 64;
+        if (tailBits != 0)
+        {
+            const uint64_t valid = (uint64_t(1) << tailBits) - 1;
+            for (int y = 0; y < source.rows; y++)
+            {
+                uint64_t &last = source.row(y)[source.wordsPerRow - 1];
+                last = (last & valid) | (fill & ~valid);
+            }
+        }
+    }
+
+    // Dilate (max) or erode (min) with a run-per-row kernel. Outside the ROI counts as the
+    // default morphology border, i.e. it never changes the result.
+    template <bool Dilate>
+    void morphPass(const PackedPlane &source, const PackedPlane &target, const KernelRuns &runs)
+    {
+        const uint64_t fill = Dilate ? 0 : ~uint64_t(0);
+        fillPadding<Dilate>(source);
+
+        for (int y = 0; y < source.rows; y++)
+        {
+            uint64_t *out = target.row(y);
+            for (int k = 0; k < source.wordsPerRow; k++)
+            {
+                uint64_t result = fill; // Dilate starts empty, erode full
+                for (const KernelRun &run : runs)
+                {
+                    const int sourceY = y + run.dy;
+                    if (sourceY < 0 || sourceY >= source.rows)
+                        continue; // Border rows are fill, which leaves the result unchanged
+                    const uint64_t *row = source.row(sourceY);
+                    for (int dx = run.first; dx <= run.last; dx++)
+                    {
+                        const uint64_t word = shiftedWord(row, k, source.wordsPerRow, dx, fill);
+                        result = Dilate ? (result | word) : (result & word);
+                    }
+                }
+                out[k] = result;
+            }
+        }
+    }
+
+    void packRoi(const cv::Mat &binary, const cv::Rect &roi, const PackedPlane &plane)
+    {
+        for (int y = 0; y < roi.height; y++)
+        {
+            const uint8_t *pixels = binary.ptr<uint8_t>(roi.y + y) + roi.x;
+            uint64_t *out = plane.row(y);
+            for (int k = 0; k < plane.wordsPerRow; k++)
+            {
+                const int begin = k * 64;
+                const int count = std::min(64, roi.width - begin);
+                uint64_t word = 0;
+                int x = 0;
+                // Eight 0/255 bytes at a time: gather their top bits into one byte
+                for (; x + 8 <= count; x += 8)
+                {
+                    uint64_t bytes;
+                    std::memcpy(&bytes, pixels + begin + x, sizeof(bytes));
+                    const uint64_t bits = ((bytes & 0x8080808080808080ull) * 0x0002040810204081ull) >> 56;
+                    word |= bits << x;
+                }
+                for (; x < count; x++)
+                {
+                    word |= uint64_t(pixels[begin + x] != 0) << x;
+                }
+                out[k] = word;
+            }
+        }
+    }
+
+    void unpackRoi(const PackedPlane &plane, const cv::Rect &roi, cv::Mat &output)
+    {
+        for (int y = 0; y < roi.height; y++)
+        {
+            uint8_t *pixels = output.ptr<uint8_t>(roi.y + y) + roi.x;
+            const uint64_t *in = plane.row(y);
+            for (int k = 0; k < plane.wordsPerRow; k++)
+            {
+                const int begin = k * 64;
+                const int count = std::min(64, roi.width - begin);
+                const uint64_t word = in[k];
+                if (word == 0 || word == ~uint64_t(0))
+                {
+                    // Most of the ROI is background, fill whole runs
+                    std::memset(pixels + begin, word ? 255 : 0, static_cast<size_t>(count));
+                    continue;
+                }
+                for (int x = 0; x < count; x++)
+                {
+                    pixels[begin + x] = static_cast<uint8_t>(-static_cast<int>((word >> x) & 1));
+                }
+            }
+        }
+    }
+}
+
+namespace
+{
+    // morphPass for the (2 * Radius + 1) square cross of getStructuringElement(MORPH_CROSS).
+    // With the shape fixed at compile time the shifts are constants and the loops unroll: the
+    // centre row contributes 2 * Radius + 1 shifted words, every other row its own word.
+    template <bool Dilate, int Radius>
+    void crossPass(const PackedPlane &source, const PackedPlane &target)
+    {
+        const uint64_t fill = Dilate ? 0 : ~uint64_t(0);
+        fillPadding<Dilate>(source);
+
+        const int words = source.wordsPerRow;
+        for (int y = 0; y < source.rows; y++)
+        {
+            const uint64_t *row = source.row(y);
+            uint64_t *out = target.row(y);
+            for (int k = 0; k < words; k++)
+            {
+                uint64_t result = row[k];
+                for (int d = 1; d <= Radius; d++)
+                {
+                    const uint64_t left = shiftedWord(row, k, words, -d, fill);
+                    const uint64_t right = shiftedWord(row, k, words, d, fill);
+                    const uint64_t up = y - d >= 0 ? source.row(y - d)[k] : fill;
+                    const uint64_t down = y + d < source.rows ? source.row(y + d)[k] : fill;
+                    result = Dilate ? (result | left | right | up | down) : (result & left & right & up & down);
+                }
+                out[k] = result;
+            }
+        }
+    }
+
+    bool packedArgumentsValid(const cv::Mat &binary, const cv::Rect &roi, const cv::Mat &output)
+    {
+        return binary.type() == CV_8UC1 && output.type() == CV_8UC1 && binary.size() == output.size() && !roi.empty();
+    }
+
+    // Packs the ROI, runs close (dilate n, erode n) then open (erode n, dilate n) like the two
+    // morphologyEx calls, and unpacks the result. pass(front, back, dilate) does one pass.
+    template <class Pass>
+    void packedCloseOpenWith(const cv::Mat &binary, const cv::Rect &roi, int iterations, cv::Mat &output,
+                             ThreadLocalMats &mats, Pass pass)
+    {
+        const int wordsPerRow = (roi.width + 63) / 64;
+        const size_t planeWords = static_cast<size_t>(wordsPerRow) * roi.height;
+        mats.morphWords.resize(2 * planeWords);
+        PackedPlane front{mats.morphWords.data(), roi.height, roi.width, wordsPerRow};
+        PackedPlane back{mats.morphWords.data() + planeWords, roi.height, roi.width, wordsPerRow};
+
+        packRoi(binary, roi, front);
+        const int passes = std::max(0, iterations);
+        for (const bool dilate : {true, false, false, true})
+        {
+            for (int i = 0; i < passes; i++)
+            {
+                pass(front, back, dilate);
+                std::swap(front, back);
+            }
+        }
+        unpackRoi(front, roi, output);
+    }
+
+    template <int Radius, int Iterations>
+    bool crossCloseOpen(const cv::Mat &binary, const cv::Rect &roi, cv::Mat &output, ThreadLocalMats &mats)
+    {
+        if (!packedArgumentsValid(binary, roi, output))
+            return false;
+        packedCloseOpenWith(binary, roi, Iterations, output, mats,
+                            [](const PackedPlane &source, const PackedPlane &target, bool dilate)
+                            {
+                                if (dilate)
+                                    crossPass<true, Radius>(source, target);
+                                else
+                                    crossPass<false, Radius>(source, target);
+                            });
+        return true;
+    }
+}
+
+bool packedCloseOpen(const cv::Mat &binary, const cv::Rect &roi, const cv::Mat &kernel, int iterations,
+                     cv::Mat &output, ThreadLocalMats &mats)
+{
+    KernelRuns runs;
+    if (!packedArgumentsValid(binary, roi, output) || !kernelRuns(kernel, runs))
+        return false;
+
+    packedCloseOpenWith(binary, roi, iterations, output, mats,
+                        [&runs](const PackedPlane &source, const PackedPlane &target, bool dilate)
+                        {
+                            if (dilate)
+                                morphPass<true>(source, target, runs);
+                            else
+                                morphPass<false>(source, target, runs);
+                        });
+    return true;
+}
+
+PipelineKernels selectPipelineKernels(const ProcessingConfig &config)
+{
+    // The combinations production configs use, everything else runs the generic kernels
+    struct CloseOpenInstance
+    {
+        int kernelSize;
+        int iterations;
+        PipelineKernels::CloseOpen closeOpen;
+    };
+    static const CloseOpenInstance closeOpenInstances[] = {
+        {3, 1, &crossCloseOpen<1, 1>},
+        {3, 2, &crossCloseOpen<1, 2>},
+        {5, 1, &crossCloseOpen<2, 1>},
+        {5, 2, &crossCloseOpen<2, 2>},
+    };
+
+    // Larger blurs aren't plain binomials, they stay with GaussianBlur
+    PipelineKernels kernels;
+    if (config.gaussian_blur_size == 3)
+        kernels.threshold = &fixedBlurSubtractThreshold<1>;
+    else if (config.gaussian_blur_size == 5)
+        kernels.threshold = &fixedBlurSubtractThreshold<2>;
+
+    for (const CloseOpenInstance &instance : closeOpenInstances)
+    {
+        if (instance.kernelSize == config.morph_kernel_size && instance.iterations == config.morph_iterations)
+            kernels.closeOpen = instance.closeOpen;
+    }
+
+    kernels.name = "blur " + (kernels.threshold ? std::to_string(config.gaussian_blur_size) : std::string("generic")) +
+                   ", cross " + (kernels.closeOpen ? std::to_string(config.morph_kernel_size) + " x" + std::to_string(config.morph_iterations)
+                                                   : std::string("generic"));
+    return kernels;
+}
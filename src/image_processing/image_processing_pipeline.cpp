@@ -0,0 +1,738 @@
+#include "image_processing/image_processing.h"
+#include "CircularBuffer/CircularBuffer.h"
+#include "acquisition/acquisition.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+// Producer side of the frame accounting, once per frame taken from the source
+static void accountAcquiredFrame(SharedResources &shared, uint64_t frameId)
+{
+    auto &accounting = shared.frameAccounting;
+    accounting.acquired.fetch_add(1, std::memory_order_relaxed);
+    if (shared.hasAcquiredFrame && frameId <= shared.lastAcquiredFrameId)
+    {
+        // Late arrival from a multi-threaded callback, it fills a gap counted earlier
+        if (frameId < shared.lastAcquiredFrameId && accounting.cameraGaps.load(std::memory_order_relaxed) > 0)
+        {
+            accounting.cameraGaps.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    if (shared.hasAcquiredFrame && frameId > shared.lastAcquiredFrameId + 1)
+    {
+        accounting.cameraGaps.fetch_add(frameId - shared.lastAcquiredFrameId - 1, std::memory_order_relaxed);
+    }
+    shared.lastAcquiredFrameId = frameId;
+    shared.hasAcquiredFrame = true;
+}
+
+void accountDroppedFrame(SharedResources &shared, uint64_t frameId)
+{
+    accountAcquiredFrame(shared, frameId);
+    shared.frameAccounting.queueOverflows.fetch_add(1, std::memory_order_relaxed);
+}
+
+void resetFrameAccounting(SharedResources &shared)
+{
+    auto &accounting = shared.frameAccounting;
+    accounting.acquired = 0;
+    accounting.analyzed = 0;
+    accounting.cameraGaps = 0;
+    accounting.queueOverflows = 0;
+    accounting.analysisDrops = 0;
+    accounting.earlyRejects = 0;
+    shared.lastAcquiredFrameId = 0;
+    shared.hasAcquiredFrame = false;
+}
+
+bool dispatchFrame(SharedResources &shared, const FrameDescriptor &frame, bool toDisplay)
+{
+    accountAcquiredFrame(shared, frame.frameId);
+
+    // The live view only needs to know something new arrived, a full ring just drops the notice
+    if (toDisplay)
+    {
+        shared.displayRing.tryPush(frame);
+    }
+
+    // Sequence numbers are only consumed by frames that actually reach the workers,
+    // otherwise the sequencer would wait forever for a frame that was never queued
+    FrameDescriptor queued = frame;
+    queued.sequence = shared.nextDispatchSequence;
+    if (!shared.processingRing.tryPush(queued))
+    {
+        shared.frameAccounting.queueOverflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    shared.nextDispatchSequence++;
+    return true;
+}
+
+void wakeFrameConsumers(SharedResources &shared)
+{
+    shared.processingRing.wake();
+    shared.displayRing.wake();
+}
+
+ResultSequencer::ResultSequencer(size_t window) : window_(window), ready_(window, 0) {}
+
+void ResultSequencer::reset(uint64_t firstSequence, Consumer consumer)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < window_.size(); i++)
+    {
+        window_[i] = FrameResult();
+        ready_[i] = 0;
+    }
+    next_ = firstSequence;
+    pending_ = 0;
+    emitting_ = false;
+    consumer_ = std::move(consumer);
+}
+
+void ResultSequencer::submit(FrameResult &&result)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t index = result.sequence % window_.size();
+        window_[index] = std::move(result);
+        ready_[index] = 1;
+        pending_++;
+
+        // Someone else is already emitting, it will pick this result up
+        if (emitting_)
+            return;
+        emitting_ = true;
+    }
+    emit();
+}
+
+void ResultSequencer::submit(std::vector<FrameResult> &results)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &result : results)
+        {
+            size_t index = result.sequence % window_.size();
+            window_[index] = std::move(result);
+            ready_[index] = 1;
+            pending_++;
+        }
+        results.clear();
+
+        if (emitting_)
+            return;
+        emitting_ = true;
+    }
+    emit();
+}
+
+void ResultSequencer::emit()
+{
+    // Empty between calls, so results don't hold on to their images until the next emit
+    std::vector<FrameResult> &batch = batch_;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t index = next_ % window_.size();
+            while (ready_[index])
+            {
+                batch.push_back(std::move(window_[index]));
+                ready_[index] = 0;
+                pending_--;
+                next_++;
+                index = next_ % window_.size();
+            }
+            if (batch.empty())
+            {
+                emitting_ = false;
+                return;
+            }
+        }
+
+        for (auto &ready : batch)
+        {
+            if (consumer_)
+                consumer_(ready);
+        }
+        batch.clear();
+    }
+}
+
+size_t ResultSequencer::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+bool DisplayResults::offer(uint64_t frameId, const cv::Mat &originalImage, const cv::Mat &processedImage,
+                           const FilterResult &result)
+{
+    if (hasPending_.load(std::memory_order_relaxed))
+        return false;
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || hasPending_)
+        return false;
+    frameId_ = frameId;
+    originalImage.copyTo(originalImage_);
+    if (processedImage.empty())
+    {
+        processedImage_.create(originalImage.size(), CV_8UC1);
+        processedImage_.setTo(0);
+    }
+    else
+    {
+        processedImage.copyTo(processedImage_);
+    }
+    result_ = result;
+    hasPending_ = true;
+    return true;
+}
+
+bool DisplayResults::take(uint64_t &frameId, cv::Mat &originalImage, cv::Mat &processedImage, FilterResult &result)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!hasPending_)
+        return false;
+    // Swapping hands the display's previous buffers back for the next offer
+    frameId = frameId_;
+    std::swap(originalImage, originalImage_);
+    std::swap(processedImage, processedImage_);
+    result = result_;
+    hasPending_ = false;
+    return true;
+}
+
+namespace
+{
+    // State of the consumers fed by the sequencer, only touched by the emitting worker
+    struct ResultPublisherState
+    {
+        size_t frameCounter = 0;
+        size_t validFrameCount = 0;
+        std::chrono::steady_clock::time_point lastValidFrameTime = std::chrono::steady_clock::now();
+        size_t ringStatsSkipped = 0; // Valid frames since the ring ratio statistics were refreshed
+    };
+
+    // Gating, recording and statistics for one frame, called in frame order
+    void publishFrameResult(SharedResources &shared, FrameResult &frameResult, ResultPublisherState &state)
+    {
+        const size_t BUFFER_THRESHOLD = 1000; // Adjust as needed
+        const auto validFrameUpdateInterval = std::chrono::seconds(1); // Update every second
+
+        if (!frameResult.analyzed)
+        {
+            shared.frameAccounting.analysisDrops.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        shared.frameAccounting.analyzed.fetch_add(1, std::memory_order_relaxed);
+        if (shared.resultObserver)
+        {
+            shared.resultObserver(frameResult);
+        }
+
+        const FilterResult &filterResult = frameResult.filterResult;
+
+        // The worker raised the trigger as soon as the frame was gated, everything below is enrichment
+        if (filterResult.isValid)
+        {
+            if (frameResult.triggerLatencyUs >= 0)
+            {
+                shared.triggerLatencies.push(reinterpret_cast<const uint8_t *>(&frameResult.triggerLatencyUs));
+            }
+            {
+                std::lock_guard<std::mutex> autofocusLock(shared.autofocusRingRatioMutex);
+                shared.autofocusRingRatioBuffer.push(reinterpret_cast<const uint8_t *>(&filterResult.ringRatio));
+                shared.ringRatioBufferSize.store(shared.autofocusRingRatioBuffer.size(), std::memory_order_relaxed);
+                // Freshness tracking for semi-auto: update timestamp and sequence
+                shared.ringRatioSequence.fetch_add(1, std::memory_order_relaxed);
+                shared.lastRingRatioTimestampNs.store(steadyNowNs(), std::memory_order_relaxed);
+            }
+
+            // Calculate ring ratio statistics from the buffer. Over budget they are only refreshed
+            // every ringStatsStride valid frames, autofocus still needs the median.
+            const size_t ringStatsStride = 32;
+            const LatencyGovernor &governor = shared.latencyGovernor;
+            const bool refreshRingStats = !governor.sheds(LatencyGovernor::NoRingStats) ||
+                                          ++state.ringStatsSkipped >= ringStatsStride;
+            if (shared.autofocusRingRatioBuffer.size() > 0 && refreshRingStats)
+            {
+                std::vector<double> ringRatios;
+                ringRatios.reserve(shared.autofocusRingRatioBuffer.size());
+
+                // Extract all ring ratios from the buffer
+                for (size_t i = 0; i < shared.autofocusRingRatioBuffer.size(); i++)
+                {
+                    const double *ratioPtr = reinterpret_cast<const double *>(shared.autofocusRingRatioBuffer.getPointer(i));
+                    if (ratioPtr && std::isfinite(*ratioPtr))
+                    {
+                        ringRatios.push_back(*ratioPtr);
+                    }
+                }
+
+                if (!ringRatios.empty())
+                {
+                    // Sort for median calculation
+                    std::vector<double> sortedRatios = ringRatios;
+                    std::sort(sortedRatios.begin(), sortedRatios.end());
+
+                    // Calculate statistics
+                    double minRatio = sortedRatios.front();
+                    double maxRatio = sortedRatios.back();
+
+                    // Calculate median
+                    double medianRatio;
+                    size_t n = sortedRatios.size();
+                    if (n % 2 == 0)
+                    {
+                        medianRatio = (sortedRatios[n / 2 - 1] + sortedRatios[n / 2]) / 2.0;
+                    }
+                    else
+                    {
+                        medianRatio = sortedRatios[n / 2];
+                    }
+
+                    // Calculate average
+                    double avgRatio = 0.0;
+                    for (double ratio : ringRatios)
+                    {
+                        avgRatio += ratio;
+                    }
+                    avgRatio /= ringRatios.size();
+
+                    // Store statistics in shared resources
+                    shared.averageRingRatio.store(avgRatio, std::memory_order_relaxed);
+                    shared.minRingRatio.store(minRatio, std::memory_order_relaxed);
+                    shared.maxRingRatio.store(maxRatio, std::memory_order_relaxed);
+                    shared.medianRingRatio.store(medianRatio, std::memory_order_relaxed);
+                    state.ringStatsSkipped = 0;
+                }
+            }
+
+            // Count valid frames for FPS calculation
+            state.validFrameCount++;
+
+            // Update valid frames per second every second
+            auto currentTime = std::chrono::steady_clock::now();
+            if (currentTime - state.lastValidFrameTime >= validFrameUpdateInterval)
+            {
+                double validFPS = static_cast<double>(state.validFrameCount) /
+                                  std::chrono::duration<double>(currentTime - state.lastValidFrameTime).count();
+                shared.validFramesPerSecond.store(validFPS, std::memory_order_relaxed);
+
+                // Reset counters for next interval
+                state.validFrameCount = 0;
+                state.lastValidFrameTime = currentTime;
+            }
+
+            // One row per cell: the frame itself, or every valid cell in multi-object mode
+            const bool perObject = !frameResult.objects.empty();
+            const size_t rows = perObject ? frameResult.objects.size() : 1;
+            {
+                std::lock_guard<std::mutex> circularitiesLock(shared.deformabilityBufferMutex);
+                if (!governor.sheds(LatencyGovernor::NoScatter))
+                {
+                    for (size_t i = 0; i < rows; i++)
+                    {
+                        const FilterResult &row = perObject ? frameResult.objects[i].result : filterResult;
+                        auto plotMetrics = std::make_tuple(row.deformability, row.area);
+                        shared.deformabilityBuffer.push(reinterpret_cast<const uint8_t *>(&plotMetrics));
+                    }
+                    shared.newScatterDataAvailable = true;
+                    shared.scatterDataCondition.notify_one();
+                }
+                shared.frameAreaRatios.store(filterResult.areaRatio);
+                shared.frameRingRatios.store(filterResult.ringRatio);
+
+                // If running is true, increment the recorded items counter
+                if (shared.running)
+                {
+                    shared.recordedItemsCount.fetch_add(rows, std::memory_order_relaxed);
+                }
+
+                if (shared.running)
+                {
+                    const int64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                                                  std::chrono::system_clock::now().time_since_epoch())
+                                                  .count();
+                    std::lock_guard<std::mutex> qualifiedResultsLock(shared.qualifiedResultsMutex);
+                    auto &currentBuffer = shared.usingBuffer1 ? shared.qualifiedResultsBuffer1
+                                                              : shared.qualifiedResultsBuffer2;
+                    for (size_t i = 0; i < rows; i++)
+                    {
+                        const FilterResult &row = perObject ? frameResult.objects[i].result : filterResult;
+                        QualifiedResult qualifiedResult;
+                        qualifiedResult.timestamp = timestamp;
+                        qualifiedResult.frameId = frameResult.frameId;
+                        qualifiedResult.areaRatio = row.areaRatio;
+                        qualifiedResult.area = row.area;
+                        qualifiedResult.deformability = row.deformability;
+                        qualifiedResult.ringRatio = row.ringRatio;
+                        qualifiedResult.brightness = row.brightness;
+                        // The worker already cloned these, nothing downstream modifies them. A cell
+                        // of a multi-object frame gets its own crop.
+                        qualifiedResult.originalImage = perObject ? frameResult.objects[i].originalImage
+                                                                  : frameResult.originalImage;
+                        qualifiedResult.processedImage = perObject ? frameResult.objects[i].processedImage
+                                                                   : frameResult.processedImage;
+                        currentBuffer.push_back(std::move(qualifiedResult));
+                    }
+
+                    if (currentBuffer.size() >= BUFFER_THRESHOLD && !shared.savingInProgress)
+                    {
+                        shared.usingBuffer1 = !shared.usingBuffer1;
+                        shared.savingInProgress = true;
+                        shared.currentBatchNumber++;
+                        shared.savingCondition.notify_one();
+                    }
+                }
+            }
+
+            // Add valid frame to the queue for the validFramesDisplayThread, unless the worker
+            // skipped the copies to stay in budget
+            if (!frameResult.originalImage.empty())
+            {
+                std::lock_guard<std::mutex> validFramesLock(shared.validFramesMutex);
+
+                // Create the valid frame data
+                SharedResources::ValidFrameData validFrame;
+                validFrame.originalImage = frameResult.originalImage;
+                validFrame.processedImage = frameResult.processedImage;
+                validFrame.result = filterResult;
+                validFrame.frameIndex = state.frameCounter++;
+                validFrame.frameId = frameResult.frameId;
+                validFrame.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::system_clock::now().time_since_epoch())
+                                           .count();
+
+                // Add to the front of the queue (newest first)
+                shared.validFramesQueue.push_front(std::move(validFrame));
+
+                // Keep only the latest 5 frames
+                const size_t MAX_VALID_FRAMES = 5;
+                while (shared.validFramesQueue.size() > MAX_VALID_FRAMES)
+                {
+                    shared.validFramesQueue.pop_back();
+                }
+
+                // Signal that a new valid frame is available
+                shared.newValidFrameAvailable = true;
+                shared.validFramesCondition.notify_one();
+            }
+        }
+
+        // Just store the processing time
+        shared.processingTimes.push(reinterpret_cast<const uint8_t *>(&frameResult.processingTimeUs));
+        shared.latencyGovernor.record(frameResult.processingTimeUs);
+        shared.updated = true;
+    }
+
+    // Fires the output trigger for a frame the gating found valid, without waiting for the frames
+    // dispatched before it. Returns the time since the frame was handed to the workers.
+    double raiseTrigger(SharedResources &shared, const FrameDescriptor &descriptor)
+    {
+        shared.processTrigger = true;
+        shared.triggerCondition.notify_one();
+        return static_cast<double>(steadyNowNs() - descriptor.enqueueNs) / 1000.0;
+    }
+
+    // Brightness quantiles of the valid cells, measured after the trigger went out
+    void enrichFrameResult(FrameResult &result, const cv::Mat &originalImage, const cv::Mat &processedImage,
+                           const cv::Rect &objectBox)
+    {
+        if (result.objects.empty())
+        {
+            result.filterResult.brightness = calculateBrightnessQuantiles(originalImage(objectBox), processedImage(objectBox));
+            return;
+        }
+        for (auto &object : result.objects)
+        {
+            object.result.brightness = calculateBrightnessQuantiles(originalImage(object.cellBox),
+                                                                    processedImage(object.cellBox));
+        }
+        result.filterResult.brightness = result.objects.front().result.brightness;
+    }
+
+    // Runs the pipeline on one frame and fills in its result
+    void analyzeFrame(const FrameDescriptor &descriptor, size_t width, size_t height, SharedResources &shared,
+                      cv::Mat &processedImage, ThreadLocalMats &mats, FrameResult &result)
+    {
+        // The descriptor carries a pool slot, holding the handle keeps the grabber buffer
+        // or staging slot from being reused until the frame has been analyzed
+        FrameHandle frame = shared.framePool->adopt(descriptor.slot);
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        cv::Mat inputImage(static_cast<int>(height), static_cast<int>(width), CV_8UC1, const_cast<uint8_t *>(frame.data()));
+
+        // Check if ROI is the same as the full image
+        const cv::Rect roi = refreshPipelineSnapshot(shared, mats).roi;
+        bool analyze = false;
+        if (static_cast<size_t>(roi.width) != width && static_cast<size_t>(roi.height) != height)
+        {
+            // Preprocess Image using the optimized processFrame function. Frames the early
+            // reject drops keep the empty default result.
+            analyze = processFrame(inputImage, shared, processedImage, mats);
+            result.snapshotVersion = mats.snapshot->version;
+            if (analyze)
+            {
+                // The settings and clamped ROI processFrame used, newer ones apply from the next frame.
+                // Gating first: the trigger goes out before brightness quantiles and copies.
+                const ProcessingConfig &config = mats.snapshot->config;
+                const LatencyGovernor &governor = shared.latencyGovernor;
+                cv::Rect objectBox;
+                result.filterResult = config.multi_object
+                                          ? analyzeObjects(processedImage, mats.roi, config, cv::Mat(), result.objects)
+                                          : filterProcessedImage(processedImage, mats.roi, config, 255, cv::Mat(), &objectBox);
+                if (result.filterResult.isValid)
+                {
+                    result.triggerLatencyUs = raiseTrigger(shared, descriptor);
+                    if (!governor.sheds(LatencyGovernor::NoBrightness))
+                    {
+                        enrichFrameResult(result, inputImage, processedImage, objectBox);
+                    }
+                }
+                if (result.filterResult.isValid && (shared.running || !governor.sheds(LatencyGovernor::NoPreviews)))
+                {
+                    // The source buffer is reused once we let go of it
+                    result.originalImage = inputImage.clone();
+                    result.processedImage = processedImage.clone();
+                }
+                if (result.filterResult.isValid)
+                {
+                    for (auto &object : result.objects)
+                    {
+                        object.originalImage = inputImage(object.box).clone();
+                        object.processedImage = processedImage(object.box).clone();
+                    }
+                }
+            }
+            else
+            {
+                shared.frameAccounting.earlyRejects.fetch_add(1, std::memory_order_relaxed);
+                if (mats.emptyFrame && shared.backgroundModel)
+                {
+                    shared.backgroundModel->offer(inputImage);
+                }
+            }
+        }
+        shared.displayResults.offer(descriptor.frameId, inputImage, analyze ? processedImage : cv::Mat(),
+                                    result.filterResult);
+        frame.reset();
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        result.processingTimeUs = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+        result.analyzed = true;
+    }
+
+    void processingWorkerTask(size_t width, size_t height, size_t workerCount, size_t batchSize,
+                              SharedResources &shared)
+    {
+        // Pre-allocate memory for images
+        cv::Mat processedImage(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
+        ThreadLocalMats mats = initializeThreadMats(static_cast<int>(height), static_cast<int>(width), shared);
+        std::vector<FrameDescriptor> batch;
+        std::vector<FrameResult> results;
+        batch.reserve(batchSize);
+        results.reserve(batchSize);
+
+        while (!shared.done)
+        {
+            FrameDescriptor descriptor;
+            if (!shared.processingRing.waitPop(descriptor, [&]()
+                                               { return shared.done.load() || shared.paused.load(); }))
+            {
+                if (shared.paused && !shared.done)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                continue;
+            }
+
+            // Take whatever else is already queued, up to the batch size, so the wakeup and the
+            // result handoff are paid once per batch instead of once per frame
+            batch.clear();
+            batch.push_back(descriptor);
+            while (batch.size() < batchSize && shared.processingRing.tryPop(descriptor))
+            {
+                batch.push_back(descriptor);
+            }
+
+            int64_t latencyNs = steadyNowNs() - batch.front().enqueueNs;
+            shared.handoffLatencyNs.store((shared.handoffLatencyNs.load(std::memory_order_relaxed) * 15 + latencyNs) / 16,
+                                          std::memory_order_relaxed);
+
+            // Analyze the newest frames: once more frames are waiting than the workers take in
+            // one batch each, this batch is already stale. Strict mode analyzes everything
+            // that made it into the queue.
+            const bool stale = !shared.processEveryFrame && shared.processingRing.size() >= workerCount * batchSize;
+
+            for (const FrameDescriptor &queued : batch)
+            {
+                results.emplace_back();
+                FrameResult &result = results.back();
+                result.sequence = queued.sequence;
+                result.frameId = queued.frameId;
+                if (stale)
+                {
+                    // Adopting and dropping the handle hands the pool slot straight back
+                    shared.framePool->adopt(queued.slot);
+                    continue;
+                }
+                analyzeFrame(queued, width, height, shared, processedImage, mats, result);
+            }
+            shared.resultSequencer.submit(results);
+        }
+
+        // Signal that this thread is ready to be joined
+        {
+            std::lock_guard<std::mutex> lock(shared.threadShutdownMutex);
+            shared.threadsReadyToJoin.fetch_add(1, std::memory_order_release);
+            shared.threadShutdownCondition.notify_one();
+        }
+
+        std::cout << "Processing worker interrupted." << std::endl;
+    }
+
+    // Folds the empty frames the workers offer into the background model and publishes the
+    // estimate, blurred, every publishInterval. Acquisition and the workers keep running, they
+    // pick the new background up with the next snapshot.
+    void backgroundModelTask(SharedResources &shared, std::chrono::milliseconds publishInterval)
+    {
+        lowerCurrentThreadPriority();
+        BackgroundModel &model = *shared.backgroundModel;
+        const uint8_t *published = nullptr; // backgroundFrame buffer the estimate last came from or went to
+        uint64_t publishedSamples = 0;
+        auto nextPublish = std::chrono::steady_clock::now() + publishInterval;
+
+        while (!shared.done)
+        {
+            // A background captured by hand ('b', a reload) restarts the estimate
+            {
+                std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
+                if (!shared.backgroundFrame.empty() && shared.backgroundFrame.data != published &&
+                    shared.backgroundFrame.type() == CV_8UC1)
+                {
+                    model.seed(shared.backgroundFrame);
+                    published = shared.backgroundFrame.data;
+                    publishedSamples = 0;
+                }
+            }
+
+            model.update(std::chrono::milliseconds(100));
+            const auto now = std::chrono::steady_clock::now();
+            if (now < nextPublish || model.samples() == publishedSamples)
+                continue;
+            nextPublish = now + publishInterval;
+
+            const int blurSize = loadPipelineSnapshot(shared)->config.gaussian_blur_size;
+            cv::Mat background = model.estimate().clone();
+            cv::Mat blurred;
+            cv::GaussianBlur(background, blurred, cv::Size(blurSize, blurSize), 0);
+            {
+                std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
+                // Replaced by hand while we blurred, that one wins
+                if (shared.backgroundFrame.data != published)
+                    continue;
+                shared.backgroundFrame = background;
+                shared.blurredBackground = blurred;
+                published = background.data;
+            }
+            publishedSamples = model.samples();
+            publishPipelineSnapshot(shared);
+
+            const std::time_t time = std::time(nullptr);
+            std::tm timeInfo;
+#ifdef _WIN32
+            localtime_s(&timeInfo, &time);
+#else
+            localtime_r(&time, &timeInfo);
+#endif
+            char buffer[9]; // HH:MM:SS + null terminator
+            strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeInfo);
+            {
+                std::lock_guard<std::mutex> lock(shared.backgroundCaptureTimeMutex);
+                shared.backgroundCaptureTime = std::string(buffer) + " (model, " + std::to_string(publishedSamples) +
+                                               " samples)";
+            }
+            shared.updated = true;
+        }
+
+        // Signal that this thread is ready to be joined
+        {
+            std::lock_guard<std::mutex> lock(shared.threadShutdownMutex);
+            shared.threadsReadyToJoin.fetch_add(1, std::memory_order_release);
+            shared.threadShutdownCondition.notify_one();
+        }
+    }
+}
+
+static int processingWorkerCount(const json &config)
+{
+    // Bounded so frames in flight always fit the sequencer window
+    return std::max(1, std::min(config.value("processing_workers", 1), 64));
+}
+
+// Frames a worker takes from the queue per wakeup, 1 analyzes frame by frame
+static int processingBatchSize(const json &config, int batchSize)
+{
+    if (batchSize <= 0)
+    {
+        batchSize = config.value("processing_batch_size", 1);
+    }
+    return std::max(1, std::min(batchSize, 32));
+}
+
+size_t processingFramesInFlight(const SharedResources &shared, const json &config, int batchSize)
+{
+    return shared.processingRing.capacity() +
+           static_cast<size_t>(processingWorkerCount(config)) * static_cast<size_t>(processingBatchSize(config, batchSize));
+}
+
+void startProcessingWorkers(SharedResources &shared, const ImageParams &params, std::vector<std::thread> &threads,
+                            int batchSize)
+{
+    json config = readConfig("config.json");
+    const int workerCount = processingWorkerCount(config);
+    shared.processingWorkers = workerCount;
+    shared.processEveryFrame = config.value("process_every_frame", false);
+    batchSize = processingBatchSize(config, batchSize);
+    shared.processingBatchSize = batchSize;
+    // p99 processing time above which optional analysis is shed, 0 never sheds
+    shared.latencyGovernor.configure(config.value("latency_budget_us", 0.0),
+                                     static_cast<size_t>(std::max(16, config.value("latency_window", 256))));
+    // Learns from the frames the early reject finds empty, so it needs early_reject on
+    shared.backgroundModel.reset();
+    const bool backgroundModel = config.value("background_model", true);
+    if (backgroundModel && !getProcessingConfig(config).early_reject)
+    {
+        std::cout << "Background model off: it learns from early rejected frames and early_reject is off" << std::endl;
+    }
+    else if (backgroundModel)
+    {
+        shared.backgroundModel = std::make_unique<BackgroundModel>(
+            std::chrono::milliseconds(std::max(1, config.value("background_sample_interval_ms", 20))));
+    }
+
+    shared.currentBatchNumber = 0;
+    shared.processTrigger = false;
+    shared.resultSequencer.reset(shared.nextDispatchSequence,
+                                 [&shared, state = ResultPublisherState()](FrameResult &result) mutable
+                                 { publishFrameResult(shared, result, state); });
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        threads.emplace_back(processingWorkerTask, params.width, params.height,
+                             static_cast<size_t>(workerCount), static_cast<size_t>(batchSize), std::ref(shared));
+    }
+    if (shared.backgroundModel)
+    {
+        const int publishInterval = std::max(1, config.value("background_publish_interval_ms", 1000));
+        threads.emplace_back(backgroundModelTask, std::ref(shared), std::chrono::milliseconds(publishInterval));
+    }
+}
@@ -1,6 +1,7 @@
 #include "image_processing/image_processing.h"
 #include "CircularBuffer/CircularBuffer.h"
 #include "mib_grabber/mib_grabber.h"
+#include "acquisition/acquisition.h"
 #include <chrono>
 #include <iostream>
 #include <conio.h>
@@ -31,62 +32,41 @@ using json = nlohmann::json;
 
 namespace fs = std::filesystem;
 
-void simulateCameraThread(
-    CircularBuffer &cameraBuffer, SharedResources &shared,
-    const ImageParams &params)
+// Achieved interval of the simulated camera against its target, with the share of on-time frames
+static std::string pacingSummary(const SharedResources &shared)
 {
-    using clock = std::chrono::high_resolution_clock;
-
-    size_t currentIndex = 0;
-    size_t totalFrames = cameraBuffer.size();
-    auto lastFrameTime = clock::now();
-    auto fpsStartTime = clock::now();
-    size_t frameCount = 0;
-
-    // Read target FPS from config.json
-    json config = readConfig("config.json");
-    const int simCameraTargetFPS = config.value("simCameraTargetFPS", 5000); // Default to 5000 if not specified
-    const std::chrono::nanoseconds frameInterval(1000000000 / simCameraTargetFPS);
-
-    while (!shared.done)
+    const FramePacer *pacer = shared.framePacer;
+    if (!pacer)
+        return "Off";
+
+    FramePacer::Stats stats = pacer->stats();
+    std::stringstream summary;
+    summary << std::fixed << std::setprecision(1) << stats.meanIntervalUs << " us mean, " << stats.maxIntervalUs << " us max";
+    if (pacer->freeRun())
     {
-        auto now = clock::now();
-        if (!shared.paused && (now - lastFrameTime) >= frameInterval)
-        {
-            const uint8_t *imageData = cameraBuffer.getPointer(currentIndex);
-            if (imageData != nullptr)
-            {
-                shared.latestCameraFrame.store(currentIndex, std::memory_order_release);
-                currentIndex = (currentIndex + 1) % totalFrames;
-                lastFrameTime = now;
-                if (++frameCount % simCameraTargetFPS == 0)
-                {
-                }
-            }
-            else
-            {
-                std::cout << "Invalid frame at index: " << currentIndex << std::endl;
-            }
-        }
-
-        if (std::chrono::duration_cast<std::chrono::seconds>(now - fpsStartTime).count() >= 5)
-        {
-            double fps = frameCount / std::chrono::duration<double>(now - fpsStartTime).count();
-            shared.currentFPS.store(fps, std::memory_order_release);
-            frameCount = 0;
-            fpsStartTime = now;
-        }
-        shared.updated = true;
+        summary << " (free-run)";
     }
-
-    // Signal that this thread is ready to be joined
+    else if (stats.frames > 0)
     {
-        std::lock_guard<std::mutex> lock(shared.threadShutdownMutex);
-        shared.threadsReadyToJoin.fetch_add(1, std::memory_order_release);
-        shared.threadShutdownCondition.notify_one();
+        // Bins 2-4 are within 10% of the target interval
+        uint64_t onTime = stats.histogram[2] + stats.histogram[3] + stats.histogram[4];
+        summary << ", target " << stats.targetIntervalUs << " us, " << std::setprecision(0)
+                << 100.0 * onTime / stats.frames << "% within 10%";
     }
+    return summary.str();
+}
 
-    std::cout << "Camera thread interrupted." << std::endl;
+// Latency budget, the last window's p99 and the optional work currently shed
+static std::string latencySummary(const SharedResources &shared)
+{
+    const LatencyGovernor &governor = shared.latencyGovernor;
+    if (!governor.enabled())
+        return "Off";
+
+    std::stringstream summary;
+    summary << std::fixed << std::setprecision(0) << "p99 " << governor.p99Us() << " / " << governor.budgetUs()
+            << " us, shedding: " << LatencyGovernor::tierName(governor.tier());
+    return summary.str();
 }
 
 void metricDisplayThread(SharedResources &shared)
@@ -151,14 +131,27 @@ void metricDisplayThread(SharedResources &shared)
     {
         auto [instantTime, avgTime, maxTime, minTime, highLatencyPct] = calculateProcessingMetrics(shared.processingTimes);
         auto [rate, recordedCount] = calculateDeformabilityBufferRate(shared);
+        const auto triggerLatency = calculateProcessingMetrics(shared.triggerLatencies);
+        const auto snapshot = loadPipelineSnapshot(shared);
 
         return window(text("Processing Metrics"), vbox({hbox({text("Avg Processing Time: "), text(std::to_string((int)avgTime) + " us")}),
                                                         hbox({text("Max Processing Time: "), text(std::to_string((int)maxTime) + " us")}),
                                                         hbox({text("High Latency (>200us): "), text(std::to_string(highLatencyPct) + "%")}),
-                                                        hbox({text("Processing Queue Size: "), text(std::to_string(shared.framesToProcess.size()) + " frames")}),
+                                                        hbox({text("Latency Budget: "), text(latencySummary(shared))}),
+                                                        hbox({text("Processing Queue Size: "), text(std::to_string(shared.processingRing.size()) + " frames")}),
+                                                        hbox({text("Processing Workers: "), text(std::to_string(shared.processingWorkers.load()) + " x batch " + std::to_string(shared.processingBatchSize.load()) + ", awaiting order " + std::to_string(shared.resultSequencer.pendingCount()))}),
+                                                        hbox({text("Handoff Latency: "), text(std::to_string(shared.handoffLatencyNs.load()) + " ns, overflows " + std::to_string(shared.processingRing.overflowCount()))}),
+                                                        hbox({text("Frames Acquired / Analyzed: "), text(std::to_string(shared.frameAccounting.acquired.load()) + " / " + std::to_string(shared.frameAccounting.analyzed.load()) + (shared.processEveryFrame.load() ? " (every frame)" : " (latest frame)"))}),
+                                                        hbox({text("Drops (gaps/overflow/skipped): "), text(std::to_string(shared.frameAccounting.cameraGaps.load()) + " / " + std::to_string(shared.frameAccounting.queueOverflows.load()) + " / " + std::to_string(shared.frameAccounting.analysisDrops.load()))}),
+                                                        hbox({text("Pipeline Kernels: "), text(snapshot ? snapshot->kernels.name : "-")}),
+                                                        hbox({text("Contour Buffer Growths: "), text(std::to_string(contourBufferGrowths()))}),
+                                                        hbox({text("Early Rejects: "), text(std::to_string(shared.frameAccounting.earlyRejects.load()) + (snapshot && !snapshot->config.early_reject ? " (off)" : ""))}),
+                                                        hbox({text("Frame Pacing: "), text(pacingSummary(shared))}),
+                                                        hbox({text("Frame Pool Free (min): "), text(shared.framePool ? std::to_string(shared.framePool->freeCount()) + " (" + std::to_string(shared.framePool->minFreeCount()) + ") / " + std::to_string(shared.framePool->capacity()) + ", exhausted " + std::to_string(shared.framePoolExhausted.load()) : "Off")}),
                                                         hbox({text("Deformability Buffer Size: "), text(std::to_string(shared.deformabilityBuffer.size()) + " sets")}),
                                                         hbox({text("Recorded Items Count: "), text(std::to_string(recordedCount) + " items")}),
                                                         hbox({text("Processed Trigger: "), text(shared.processTrigger.load() ? "Yes" : "No")}),
+                                                        hbox({text("Trigger Latency (avg/max): "), text(std::to_string((int)std::get<1>(triggerLatency)) + " / " + std::to_string((int)std::get<2>(triggerLatency)) + " us")}),
                                                         hbox({text("Trigger Onset Duration: "), text(std::to_string(shared.triggerOnsetDuration.load()) + " us")}),
                                                         hbox({text("Deformability: "), text(std::to_string(shared.frameDeformabilities.load()))}),
                                                         hbox({text("Area: "), text(std::to_string(shared.frameAreas.load()))}),
@@ -175,6 +168,9 @@ void metricDisplayThread(SharedResources &shared)
 
     auto render_config_metrics = [&]()
     {
+        // The published settings, the live fields may be mid-update
+        const auto snapshot = loadPipelineSnapshot(shared);
+        const ProcessingConfig config = snapshot ? snapshot->config : ProcessingConfig();
         return window(text("Configuration"), vbox({
                                                  hbox({text("Current FPS: "),
                                                        text(std::to_string((int)shared.currentFPS.load()))}),
@@ -183,18 +179,18 @@ void metricDisplayThread(SharedResources &shared)
                                                  hbox({text("Exposure Time: "),
                                                        text(std::to_string((int)shared.exposureTime.load()))}),
                                                  hbox({text("Binary Threshold: "),
-                                                       text(std::to_string(shared.processingConfig.bg_subtract_threshold))}),
+                                                       text(std::to_string(config.bg_subtract_threshold))}),
                                                  // display if valid display frame
                                                  hbox({text("Valid Display Frame: "),
                                                        text(shared.validDisplayFrame.load() ? "Yes" : "No")}),
                                                  hbox({text("Touched Border: "),
                                                        text(shared.displayFrameTouchedBorder.load() ? "Yes" : "No")}),
                                                  hbox({text("Require Single Inner Contour: "),
-                                                       text(shared.processingConfig.require_single_inner_contour ? "Yes" : "No")}),
+                                                       text(config.require_single_inner_contour ? "Yes" : "No")}),
                                                  hbox({text("Area Min Threshold: "),
-                                                       text(std::to_string(shared.processingConfig.area_threshold_min))}),
+                                                       text(std::to_string(config.area_threshold_min))}),
                                                  hbox({text("Area Max Threshold: "),
-                                                       text(std::to_string(shared.processingConfig.area_threshold_max))}),
+                                                       text(std::to_string(config.area_threshold_max))}),
                                                  // Contrast enhancement removed
                                              }));
     };
@@ -506,249 +502,8 @@ void validFramesDisplayThread(SharedResources &shared, const CircularBuffer &cir
     std::cout << "Valid frames display thread interrupted." << std::endl;
 }
 
-void processingThreadTask(
-    std::mutex &processingQueueMutex,
-    std::condition_variable &processingQueueCondition,
-    std::queue<size_t> &framesToProcess,
-    const CircularBuffer &processingBuffer,
-    size_t width, size_t height, SharedResources &shared)
-{
-    shared.currentBatchNumber = 0;
-    // Pre-allocate memory for images
-    cv::Mat inputImage(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
-    cv::Mat processedImage(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
-    ThreadLocalMats mats = initializeThreadMats(static_cast<int>(height), static_cast<int>(width), shared);
-    const size_t BUFFER_THRESHOLD = 1000; // Adjust as needed
-    // const size_t area_threshold = 10;
-    const uint8_t processedColor = 255; // grey scaled cell color
-    shared.processTrigger = false;
-
-    // Initialize frame counter
-    size_t frameCounter = 0;
-
-    // Initialize valid frames per second tracking
-    size_t validFrameCount = 0;
-    auto lastValidFrameTime = std::chrono::steady_clock::now();
-    const auto validFrameUpdateInterval = std::chrono::seconds(1); // Update every second
-
-    while (!shared.done)
-    {
-        std::unique_lock<std::mutex> lock(processingQueueMutex);
-        processingQueueCondition.wait(lock, [&]()
-                                      { return !framesToProcess.empty() || shared.done || shared.paused; });
-
-        if (shared.done)
-            break;
-
-        if (!framesToProcess.empty() && !shared.paused)
-        {
-            // size_t frame = framesToProcess.front(); //retrieve content of queue
-            framesToProcess.pop();
-            lock.unlock();
-
-            auto startTime = std::chrono::high_resolution_clock::now();
-            shared.validProcessingFrame = false;
-            auto imageData = processingBuffer.get(0);
-            inputImage = cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC1, imageData.data());
-
-            // Check if ROI is the same as the full image
-            if (static_cast<size_t>(shared.roi.width) != width && static_cast<size_t>(shared.roi.height) != height)
-            {
-                // Preprocess Image using the optimized processFrame function
-                processFrame(inputImage, shared, processedImage, mats);
-                auto filterResult = filterProcessedImage(processedImage, shared.roi, shared.processingConfig, 255, inputImage);
-
-                // Use the isValid flag directly from filterResult without creating a redundant local variable
-                if (filterResult.isValid)
-                {
-                    shared.processTrigger = true;
-                    shared.triggerCondition.notify_one();
-                    shared.validProcessingFrame = true;
-                    {
-                        std::lock_guard<std::mutex> autofocusLock(shared.autofocusRingRatioMutex);
-                        shared.autofocusRingRatioBuffer.push(reinterpret_cast<const uint8_t *>(&filterResult.ringRatio));
-                        shared.ringRatioBufferSize.store(shared.autofocusRingRatioBuffer.size(), std::memory_order_relaxed);
-                        // Freshness tracking for semi-auto: update timestamp and sequence
-                        shared.ringRatioSequence.fetch_add(1, std::memory_order_relaxed);
-                        auto nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                         std::chrono::steady_clock::now().time_since_epoch())
-                                         .count();
-                        shared.lastRingRatioTimestampNs.store(nowNs, std::memory_order_relaxed);
-                    }
-
-                    // Calculate ring ratio statistics from the buffer
-                    if (shared.autofocusRingRatioBuffer.size() > 0)
-                    {
-                        std::vector<double> ringRatios;
-                        ringRatios.reserve(shared.autofocusRingRatioBuffer.size());
-
-                        // Extract all ring ratios from the buffer
-                        for (size_t i = 0; i < shared.autofocusRingRatioBuffer.size(); i++)
-                        {
-                            const double *ratioPtr = reinterpret_cast<const double *>(shared.autofocusRingRatioBuffer.getPointer(i));
-                            if (ratioPtr && std::isfinite(*ratioPtr))
-                            {
-                                ringRatios.push_back(*ratioPtr);
-                            }
-                        }
-
-                        if (!ringRatios.empty())
-                        {
-                            // Sort for median calculation
-                            std::vector<double> sortedRatios = ringRatios;
-                            std::sort(sortedRatios.begin(), sortedRatios.end());
-
-                            // Calculate statistics
-                            double minRatio = sortedRatios.front();
-                            double maxRatio = sortedRatios.back();
-
-                            // Calculate median
-                            double medianRatio;
-                            size_t n = sortedRatios.size();
-                            if (n % 2 == 0)
-                            {
-                                medianRatio = (sortedRatios[n / 2 - 1] + sortedRatios[n / 2]) / 2.0;
-                            }
-                            else
-                            {
-                                medianRatio = sortedRatios[n / 2];
-                            }
-
-                            // Calculate average
-                            double avgRatio = 0.0;
-                            for (double ratio : ringRatios)
-                            {
-                                avgRatio += ratio;
-                            }
-                            avgRatio /= ringRatios.size();
-
-                            // Store statistics in shared resources
-                            shared.averageRingRatio.store(avgRatio, std::memory_order_relaxed);
-                            shared.minRingRatio.store(minRatio, std::memory_order_relaxed);
-                            shared.maxRingRatio.store(maxRatio, std::memory_order_relaxed);
-                            shared.medianRingRatio.store(medianRatio, std::memory_order_relaxed);
-                        }
-                    }
-
-                    // Count valid frames for FPS calculation
-                    validFrameCount++;
-
-                    // Update valid frames per second every second
-                    auto currentTime = std::chrono::steady_clock::now();
-                    if (currentTime - lastValidFrameTime >= validFrameUpdateInterval)
-                    {
-                        double validFPS = static_cast<double>(validFrameCount) /
-                                          std::chrono::duration<double>(currentTime - lastValidFrameTime).count();
-                        shared.validFramesPerSecond.store(validFPS, std::memory_order_relaxed);
-
-                        // Reset counters for next interval
-                        validFrameCount = 0;
-                        lastValidFrameTime = currentTime;
-                    }
-
-                    auto plotMetrics = std::make_tuple(filterResult.deformability, filterResult.area);
-                    {
-                        std::lock_guard<std::mutex> circularitiesLock(shared.deformabilityBufferMutex);
-                        shared.deformabilityBuffer.push(reinterpret_cast<const uint8_t *>(&plotMetrics));
-                        shared.frameAreaRatios.store(filterResult.areaRatio);
-                        shared.frameRingRatios.store(filterResult.ringRatio);
-
-                        shared.newScatterDataAvailable = true;
-                        shared.scatterDataCondition.notify_one();
-
-                        // If running is true, increment the recorded items counter
-                        if (shared.running)
-                        {
-                            shared.recordedItemsCount.fetch_add(1, std::memory_order_relaxed);
-                        }
-
-                        if (shared.running)
-                        {
-                            QualifiedResult qualifiedResult;
-                            qualifiedResult.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-                                                            std::chrono::system_clock::now().time_since_epoch())
-                                                            .count();
-                            qualifiedResult.areaRatio = filterResult.areaRatio;
-                            qualifiedResult.area = filterResult.area;
-                            qualifiedResult.deformability = filterResult.deformability;
-                            qualifiedResult.ringRatio = filterResult.ringRatio;
-                            qualifiedResult.brightness = filterResult.brightness;
-                            qualifiedResult.originalImage = inputImage.clone();
-                            qualifiedResult.processedImage = processedImage.clone();
-
-                            std::lock_guard<std::mutex> qualifiedResultsLock(shared.qualifiedResultsMutex);
-                            auto &currentBuffer = shared.usingBuffer1 ? shared.qualifiedResultsBuffer1
-                                                                      : shared.qualifiedResultsBuffer2;
-                            currentBuffer.push_back(std::move(qualifiedResult));
-
-                            if (currentBuffer.size() >= BUFFER_THRESHOLD && !shared.savingInProgress)
-                            {
-                                shared.usingBuffer1 = !shared.usingBuffer1;
-                                shared.savingInProgress = true;
-                                shared.currentBatchNumber++;
-                                shared.savingCondition.notify_one();
-                            }
-                        }
-                    }
-
-                    // Add valid frame to the queue for the validFramesDisplayThread
-                    {
-                        std::lock_guard<std::mutex> validFramesLock(shared.validFramesMutex);
-
-                        // Create the valid frame data
-                        SharedResources::ValidFrameData validFrame;
-                        validFrame.originalImage = inputImage.clone();
-                        validFrame.processedImage = processedImage.clone();
-                        validFrame.result = filterResult;
-                        validFrame.frameIndex = frameCounter++;
-                        validFrame.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                                   std::chrono::system_clock::now().time_since_epoch())
-                                                   .count();
-
-                        // Add to the front of the queue (newest first)
-                        shared.validFramesQueue.push_front(std::move(validFrame));
-
-                        // Keep only the latest 5 frames
-                        const size_t MAX_VALID_FRAMES = 5;
-                        while (shared.validFramesQueue.size() > MAX_VALID_FRAMES)
-                        {
-                            shared.validFramesQueue.pop_back();
-                        }
-
-                        // Signal that a new valid frame is available
-                        shared.newValidFrameAvailable = true;
-                        shared.validFramesCondition.notify_one();
-                    }
-                }
-            }
-
-            auto endTime = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
-            double processingTime = static_cast<double>(duration.count());
-
-            // Just store the processing time
-            shared.processingTimes.push(reinterpret_cast<const uint8_t *>(&processingTime));
-            shared.updated = true;
-        }
-        else
-        {
-            lock.unlock();
-        }
-    }
-
-    // Signal that this thread is ready to be joined
-    {
-        std::lock_guard<std::mutex> lock(shared.threadShutdownMutex);
-        shared.threadsReadyToJoin.fetch_add(1, std::memory_order_release);
-        shared.threadShutdownCondition.notify_one();
-    }
-
-    std::cout << "Processing thread interrupted." << std::endl;
-}
-
 void displayThreadTask(
-    std::queue<size_t> &framesToDisplay,
-    std::mutex &displayQueueMutex,
+    SpscRing<FrameDescriptor> &displayRing,
     const CircularBuffer &circularBuffer,
     size_t width,
     size_t height,
@@ -768,6 +523,10 @@ void displayThreadTask(
     cv::Mat image(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
     cv::Mat processedImage(static_cast<int>(height), static_cast<int>(width), CV_8UC1);
     cv::Mat displayImage(static_cast<int>(height), static_cast<int>(width), CV_8UC3);
+    // Live frames come analyzed from the workers, these are swapped with shared.displayResults
+    cv::Mat liveImage;
+    cv::Mat liveProcessedImage;
+    uint64_t liveFrameId = 0;
 
     cv::namedWindow("Live Feed", cv::WINDOW_AUTOSIZE);
     cv::resizeWindow("Live Feed", static_cast<int>(width), static_cast<int>(height));
@@ -827,8 +586,11 @@ void displayThreadTask(
             if (distance > 5)
             {
                 cv::Rect newRoi(startPoint, endPoint);
-                std::lock_guard<std::mutex> lock(sharedResources->roiMutex);
-                sharedResources->roi = newRoi;
+                {
+                    std::lock_guard<std::mutex> lock(sharedResources->roiMutex);
+                    sharedResources->roi = newRoi;
+                }
+                publishPipelineSnapshot(*sharedResources);
                 sharedResources->displayNeedsUpdate = true;
             }
         }
@@ -845,17 +607,17 @@ void displayThreadTask(
         {
             if (now >= nextFrameTime)
             {
-                std::unique_lock<std::mutex> lock(displayQueueMutex);
-                if (!framesToDisplay.empty())
+                // Drain the notices queued since the last refresh, the grabber only copies frames
+                // to the history while the ring is empty
+                FrameDescriptor descriptor;
+                while (displayRing.tryPop(descriptor))
                 {
-                    framesToDisplay.pop();
-                    lock.unlock();
-
-                    auto imageData = circularBuffer.get(0);
-                    image = cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC1, imageData.data());
-                    processFrame(image, shared, processedImage, mats);
-                    auto filterResult = filterProcessedImage(processedImage, shared.roi, shared.processingConfig, 255, image);
+                }
 
+                // Show the newest frame a worker analyzed instead of running the pipeline again
+                FilterResult filterResult{};
+                if (shared.displayResults.take(liveFrameId, liveImage, liveProcessedImage, filterResult))
+                {
                     // Update shared state variables
                     shared.hasSingleInnerContour = filterResult.hasSingleInnerContour;
                     shared.innerContourCount = filterResult.innerContourCount;
@@ -879,7 +641,7 @@ void displayThreadTask(
                         shared.frameRingRatios.store(-filterResult.ringRatio);
                     }
 
-                    updateDisplay(image, processedImage, filterResult);
+                    updateDisplay(liveImage, liveProcessedImage, filterResult);
                     shouldUpdate = true;
 
                     nextFrameTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameDuration);
@@ -924,10 +686,11 @@ void displayThreadTask(
                         {
                             updateBackgroundWithCurrentSettings(shared);
                         }
+                        publishPipelineSnapshot(shared);
 
                         image = cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC1, imageData.data());
                         processFrame(image, shared, processedImage, mats);
-                        auto filterResult = filterProcessedImage(processedImage, shared.roi, shared.processingConfig, 255, image);
+                        auto filterResult = filterProcessedImage(processedImage, mats.roi, mats.snapshot->config, 255, image);
 
                         // Update shared state variables
                         shared.hasSingleInnerContour = filterResult.hasSingleInnerContour;
@@ -970,8 +733,7 @@ void displayThreadTask(
                 // Handle ESC immediately even if keyboard callback isn't initialized yet
                 shared.done = true;
                 shared.validFramesCondition.notify_all();
-                shared.displayQueueCondition.notify_all();
-                shared.processingQueueCondition.notify_all();
+                wakeFrameConsumers(shared);
                 shared.savingCondition.notify_all();
                 shared.scatterDataCondition.notify_all();
                 shared.newValidFrameAvailable = true;
@@ -1334,8 +1096,7 @@ void keyboardHandlingThread(
 
             // Signal all condition variables to wake up their threads
             shared.validFramesCondition.notify_all();
-            shared.displayQueueCondition.notify_all();
-            shared.processingQueueCondition.notify_all();
+            wakeFrameConsumers(shared);
             shared.savingCondition.notify_all();
             shared.scatterDataCondition.notify_all();
             shared.triggerCondition.notify_all();
@@ -1474,6 +1235,7 @@ void keyboardHandlingThread(
                 strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeInfo);
                 shared.backgroundCaptureTime = buffer;
             }
+            publishPipelineSnapshot(shared);
             shared.displayNeedsUpdate = true;
             shared.updated = true; // Ensure dashboard gets updated
             shared.triggerCondition.notify_all();
@@ -1626,6 +1388,7 @@ void commonSampleLogic(SharedResources &shared, const std::string &SAVE_DIRECTOR
     shared.qualifiedResults.clear();
     shared.totalSavedResults = 0;
     shared.recordedItemsCount = 0; // Initialize recorded items counter
+    resetFrameAccounting(shared);
 
     // Reset thread counting
     shared.activeThreadCount = 0;
@@ -1664,8 +1427,7 @@ void commonSampleLogic(SharedResources &shared, const std::string &SAVE_DIRECTOR
         std::cout << "Waiting for all threads to complete..." << std::endl;
 
         // Send signals to all condition variables to wake threads that might be waiting
-        shared.displayQueueCondition.notify_all();
-        shared.processingQueueCondition.notify_all();
+        wakeFrameConsumers(shared);
         shared.savingCondition.notify_all();
         shared.validFramesCondition.notify_all();
         shared.scatterDataCondition.notify_all();
@@ -1685,20 +1447,25 @@ void commonSampleLogic(SharedResources &shared, const std::string &SAVE_DIRECTOR
     {
         thread.join();
     }
+
+    const auto &accounting = shared.frameAccounting;
+    std::cout << "Frames acquired: " << accounting.acquired.load()
+              << ", analyzed: " << accounting.analyzed.load()
+              << ", camera gaps: " << accounting.cameraGaps.load()
+              << ", queue overflows: " << accounting.queueOverflows.load()
+              << ", analysis drops: " << accounting.analysisDrops.load()
+              << ", early rejects: " << accounting.earlyRejects.load() << std::endl;
+    saveFrameAccounting(shared, saveDir);
 }
 
 void setupCommonThreads(SharedResources &shared, const std::string &saveDir,
-                        const CircularBuffer &circularBuffer, const CircularBuffer &processingBuffer, const ImageParams &params,
+                        const CircularBuffer &circularBuffer, const ImageParams &params,
                         std::vector<std::thread> &threads)
 {
-    // Create processing thread first and set its priority
-    threads.emplace_back(processingThreadTask,
-                         std::ref(shared.processingQueueMutex), std::ref(shared.processingQueueCondition),
-                         std::ref(shared.framesToProcess), std::ref(processingBuffer),
-                         params.width, params.height, std::ref(shared));
+    // Create processing workers first
+    startProcessingWorkers(shared, params, threads);
     // Create remaining threads with normal priority
-    threads.emplace_back(displayThreadTask, std::ref(shared.framesToDisplay),
-                         std::ref(shared.displayQueueMutex), std::ref(circularBuffer),
+    threads.emplace_back(displayThreadTask, std::ref(shared.displayRing), std::ref(circularBuffer),
                          params.width, params.height, params.bufferCount, std::ref(shared));
 
     threads.emplace_back(keyboardHandlingThread,
@@ -1728,45 +1495,54 @@ void setupCommonThreads(SharedResources &shared, const std::string &saveDir,
     }
 }
 
-void temp_mockSample(const ImageParams &params, CircularBuffer &cameraBuffer, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared)
+// Every sample runs the same way, only the source of its frames differs
+void runFrameSource(FrameSource &source, SharedResources &shared)
 {
+    const ImageParams &params = source.params();
+    CircularBuffer circularBuffer(params.bufferCount, params.imageSize);
+    // Sources without a frame pool of their own stage into one sized to what the workers can hold,
+    // copying only frames that do not stay valid for the whole run
+    std::unique_ptr<FrameStaging> staging;
+    if (!source.framePool())
+    {
+        staging = std::make_unique<FrameStaging>(processingFramesInFlight(shared, readConfig("config.json")), params.imageSize,
+                                                 !source.stableFrames());
+    }
+
+    source.initializeBackground(shared);
+    shared.roi = cv::Rect(0, 0, static_cast<int>(params.width), static_cast<int>(params.height));
+
+    // Generated frames come with labels for the ROI their cells were placed in
+    std::unique_ptr<GatingScore> score;
+    if (source.groundTruth())
+    {
+        shared.roi = headlessRoi(readConfig("config.json"), params);
+        score = std::make_unique<GatingScore>(*source.groundTruth());
+        score->attach(shared);
+    }
+    publishPipelineSnapshot(shared);
+
+    shared.framePacer = source.pacer();
+    shared.framePool = staging ? &staging->pool() : source.framePool();
     commonSampleLogic(shared, "default_save_directory", [&](SharedResources &shared, const std::string &saveDir)
                       {
                           std::vector<std::thread> threads;
-                          setupCommonThreads(shared, saveDir, circularBuffer, processingBuffer, params, threads);
-
-                          threads.emplace_back(simulateCameraThread,
-                                               std::ref(cameraBuffer), std::ref(shared), std::ref(params));
-
-                          size_t lastProcessedFrame = 0;
-                          while (!shared.done)
-                          {
-                              if (shared.paused)
-                              {
-                                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                                  continue;
-                              }
-                              size_t latestFrame = shared.latestCameraFrame.load(std::memory_order_acquire);
-                              if (latestFrame != lastProcessedFrame)
-                              {
-                                  const uint8_t *imageData = cameraBuffer.getPointer(latestFrame);
-                                  if (imageData != nullptr)
-                                  {
-                                      circularBuffer.push(imageData);
-                                      processingBuffer.push(imageData);
-                                      {
-                                          std::lock_guard<std::mutex> displayLock(shared.displayQueueMutex);
-                                          std::lock_guard<std::mutex> processingLock(shared.processingQueueMutex);
-                                          shared.framesToProcess.push(latestFrame);
-                                          shared.framesToDisplay.push(latestFrame);
-                                      }
-                                      shared.displayQueueCondition.notify_one();
-                                      shared.processingQueueCondition.notify_one();
-                                      lastProcessedFrame = latestFrame;
-                                  }
-                              }
-                          }
+                          setupCommonThreads(shared, saveDir, circularBuffer, params, threads);
+                          source.startThreads(shared, threads);
+
+                          // The source feeds the pipeline from this thread until shutdown
+                          source.run(shared, circularBuffer, staging.get());
                           return threads; });
+
+    // All threads are joined, so no frame handle outlives the pool
+    shared.framePacer = nullptr;
+    shared.framePool = nullptr;
+    shared.resultObserver = nullptr;
+    source.printSummary();
+    if (score)
+    {
+        score->print();
+    }
 }
 
 void autofocusControlThread(SharedResources &shared)
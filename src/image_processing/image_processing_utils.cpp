@@ -1,13 +1,14 @@
 #include "image_processing/image_processing.h"
 #include "CircularBuffer/CircularBuffer.h"
+#include <algorithm>
 #include <filesystem>
 #include <system_error>
 #include <iostream>
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <future>
+#include <thread>
 #include <vector>
-#include "menu_system/menu_system.h"
 
 void createDefaultConfigIfMissing(const std::filesystem::path &configPath)
 {
@@ -144,86 +145,233 @@ std::string selectSaveDirectory(const std::string &configPath)
     return absolutePath.string();
 }
 
-ImageParams initializeImageParams(const std::string &directory)
+namespace
 {
-    ImageParams params;
-    // Read target FPS from config.json
-    json config = readConfig("config.json");
-    const int simCameraTargetFPS = config.value("simCameraTargetFPS", 5000); // Default to 5000 if not specified
-    params.bufferCount = simCameraTargetFPS;
+    bool isImageFile(const std::filesystem::path &path)
+    {
+        const auto extension = path.extension();
+        return extension == ".tiff" || extension == ".tif" || extension == ".png" ||
+               extension == ".jpg" || extension == ".jpeg";
+    }
 
-    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    // Sorted, so the frame order follows the file names
+    std::vector<std::filesystem::path> listImageFiles(const std::string &directory)
     {
-        if (entry.path().extension() == ".tiff" || entry.path().extension() == ".tif" ||
-            entry.path().extension() == ".png" || entry.path().extension() == ".jpg" ||
-            entry.path().extension() == ".jpeg")
+        std::vector<std::filesystem::path> imagePaths;
+        for (const auto &entry : std::filesystem::directory_iterator(directory))
         {
-            cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_GRAYSCALE);
-            if (!image.empty())
+            if (isImageFile(entry.path()))
             {
-                params.width = image.cols;
-                params.height = image.rows;
-                params.pixelFormat = image.type();
-                params.imageSize = image.total() * image.elemSize();
-                return params;
+                imagePaths.push_back(entry.path());
             }
         }
+        std::sort(imagePaths.begin(), imagePaths.end());
+        return imagePaths;
     }
 
-    throw std::runtime_error("No valid TIFF images found in the directory");
-}
+    size_t decodeThreadCount(const json &config)
+    {
+        const int configured = config.value("image_decode_threads", 0);
+        if (configured > 0)
+            return static_cast<size_t>(configured);
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
 
-void loadImages(const std::string &directory, CircularBuffer &cameraBuffer, bool reverseOrder)
-{
-    std::vector<std::filesystem::path> imagePaths;
-    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    // Decodes the images on several threads and hands them to onImage in path order.
+    // Works through the list in blocks, so only a block of decoded images is held at a time.
+    void forEachDecodedImage(const std::vector<std::filesystem::path> &imagePaths, size_t threadCount,
+                             const std::function<void(const cv::Mat &)> &onImage)
     {
-        if (entry.path().extension() == ".tiff" || entry.path().extension() == ".tif" ||
-            entry.path().extension() == ".png" || entry.path().extension() == ".jpg" ||
-            entry.path().extension() == ".jpeg")
+        const size_t blockSize = 32 * threadCount;
+        std::vector<cv::Mat> block;
+        for (size_t begin = 0; begin < imagePaths.size(); begin += blockSize)
         {
-            imagePaths.push_back(entry.path());
+            const size_t count = std::min(blockSize, imagePaths.size() - begin);
+            block.assign(count, cv::Mat());
+
+            // Interleaved, so a few slow files don't leave the other threads idle
+            const size_t workers = std::min(threadCount, count);
+            std::vector<std::future<void>> tasks;
+            for (size_t worker = 0; worker < workers; worker++)
+            {
+                tasks.push_back(std::async(std::launch::async, [&, worker]()
+                                           {
+                                               for (size_t i = worker; i < count; i += workers)
+                                               {
+                                                   block[i] = cv::imread(imagePaths[begin + i].string(), cv::IMREAD_GRAYSCALE);
+                                               } }));
+            }
+            for (auto &task : tasks)
+            {
+                task.get();
+            }
+
+            for (const cv::Mat &image : block)
+            {
+                if (!image.empty())
+                {
+                    onImage(image);
+                }
+            }
         }
     }
 
-    std::sort(imagePaths.begin(), imagePaths.end());
+    // Changes whenever an image is added, removed, renamed or rewritten
+    uint64_t imageSetFingerprint(const std::vector<std::filesystem::path> &imagePaths)
+    {
+        uint64_t hash = 1469598103934665603ull; // FNV-1a
+        auto mix = [&hash](const void *data, size_t size)
+        {
+            const auto *bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        for (const auto &path : imagePaths)
+        {
+            const std::string name = path.filename().string();
+            const uint64_t size = std::filesystem::file_size(path);
+            const int64_t modified = std::filesystem::last_write_time(path).time_since_epoch().count();
+            mix(name.data(), name.size() + 1);
+            mix(&size, sizeof(size));
+            mix(&modified, sizeof(modified));
+        }
+        return hash;
+    }
 
-    if (reverseOrder)
+    // Loose images decoded once into a packed cache next to them; later runs map the cache.
+    // Frames are stored in file name order, the order the simulated camera plays them in.
+    std::unique_ptr<PackedFrameSequence> openImageCache(const std::string &directory, const json &config)
     {
-        std::reverse(imagePaths.begin(), imagePaths.end());
+        const std::vector<std::filesystem::path> imagePaths = listImageFiles(directory);
+        if (imagePaths.empty())
+        {
+            throw std::runtime_error("No valid TIFF images found in the directory");
+        }
+        const uint64_t fingerprint = imageSetFingerprint(imagePaths);
+        const std::string cachePath = (std::filesystem::path(directory) / "mib_frame_cache.raw").string();
+
+        if (std::filesystem::exists(cachePath))
+        {
+            try
+            {
+                auto cached = std::make_unique<PackedFrameSequence>(cachePath);
+                if (cached->fingerprint() == fingerprint)
+                {
+                    std::cout << "Mapped " << cached->frameCount() << " cached frames from " << cachePath << std::endl;
+                    return cached;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Rebuilding frame cache: " << e.what() << std::endl;
+            }
+        }
+
+        const size_t threadCount = decodeThreadCount(config);
+        std::cout << "Decoding " << imagePaths.size() << " images on " << threadCount << " threads..." << std::endl;
+        const auto start = std::chrono::steady_clock::now();
+
+        std::unique_ptr<PackedFrameWriter> writer;
+        cv::Size frameSize;
+        size_t skipped = 0;
+        forEachDecodedImage(imagePaths, threadCount, [&](const cv::Mat &image)
+                            {
+                                if (!writer)
+                                {
+                                    frameSize = image.size();
+                                    writer = std::make_unique<PackedFrameWriter>(cachePath, image.rows, image.cols, image.type(), fingerprint);
+                                }
+                                if (image.size() != frameSize || !image.isContinuous())
+                                {
+                                    skipped++;
+                                    return;
+                                }
+                                writer->append(image.data); });
+        if (!writer)
+        {
+            throw std::runtime_error("No valid TIFF images found in the directory");
+        }
+        writer->finish();
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Cached " << writer->frameCount() << " frames in " << seconds << " s";
+        if (skipped > 0)
+        {
+            std::cout << ", skipped " << skipped << " images of a different size";
+        }
+        std::cout << std::endl;
+        return std::make_unique<PackedFrameSequence>(cachePath);
     }
+}
 
-    for (const auto &path : imagePaths)
+ImageParams initializeImageParams(const std::string &directory)
+{
+    ImageParams params;
+    // Read target FPS from config.json
+    json config = readConfig("config.json");
+    const int simCameraTargetFPS = config.value("simCameraTargetFPS", 5000); // Default to 5000 if not specified
+    params.bufferCount = simCameraTargetFPS;
+
+    for (const auto &path : listImageFiles(directory))
     {
         cv::Mat image = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
         if (!image.empty())
         {
-            cameraBuffer.push(image.data);
+            params.width = image.cols;
+            params.height = image.rows;
+            params.pixelFormat = image.type();
+            params.imageSize = image.total() * image.elemSize();
+            return params;
         }
     }
 
-    std::cout << "Loaded " << cameraBuffer.size() << " images into camera buffer." << std::endl;
+    throw std::runtime_error("No valid TIFF images found in the directory");
 }
 
-void initializeMockBackgroundFrame(SharedResources &shared, const ImageParams &params, const CircularBuffer &cameraBuffer)
+void loadImages(const std::string &directory, CircularBuffer &cameraBuffer, bool reverseOrder)
 {
-    std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
+    std::vector<std::filesystem::path> imagePaths = listImageFiles(directory);
+
+    if (reverseOrder)
+    {
+        std::reverse(imagePaths.begin(), imagePaths.end());
+    }
+
+    forEachDecodedImage(imagePaths, decodeThreadCount(readConfig("config.json")), [&](const cv::Mat &image)
+                        {
+                            // A differently sized image would overrun the slot
+                            if (image.isContinuous() && image.total() * image.elemSize() == cameraBuffer.imageSize())
+                            {
+                                cameraBuffer.push(image.data);
+                            } });
 
+    std::cout << "Loaded " << cameraBuffer.size() << " images into camera buffer." << std::endl;
+}
+
+void initializeMockBackgroundFrame(SharedResources &shared, const ImageParams &params, const FrameSequence &frames)
+{
     // Select an image from the middle of the buffer as the background
     size_t selectedIndex = 0;
-    std::vector<uchar> imageData = cameraBuffer.get(selectedIndex);
+    {
+        std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
+        const uint8_t *imageData = frames.frame(selectedIndex);
 
-    // Create a cv::Mat from the image data
-    cv::Mat selectedImage(static_cast<int>(params.height), static_cast<int>(params.width), CV_8UC1, imageData.data());
+        // Create a cv::Mat from the image data
+        cv::Mat selectedImage(static_cast<int>(params.height), static_cast<int>(params.width), CV_8UC1,
+                              const_cast<uint8_t *>(imageData));
 
-    // Clone the selected image to create the background frame
-    shared.backgroundFrame = selectedImage.clone();
+        // Clone the selected image to create the background frame
+        shared.backgroundFrame = selectedImage.clone();
 
-    // Apply Gaussian blur to the background frame
-    cv::GaussianBlur(shared.backgroundFrame, shared.blurredBackground,
-                     cv::Size(shared.processingConfig.gaussian_blur_size,
-                              shared.processingConfig.gaussian_blur_size),
-                     0);
+        // Apply Gaussian blur to the background frame
+        cv::GaussianBlur(shared.backgroundFrame, shared.blurredBackground,
+                         cv::Size(shared.processingConfig.gaussian_blur_size,
+                                  shared.processingConfig.gaussian_blur_size),
+                         0);
+    }
+    publishPipelineSnapshot(shared);
 
     std::cout << "Background frame initialized from loaded image at index: " << selectedIndex << std::endl;
 
@@ -234,12 +382,112 @@ void initializeMockBackgroundFrame(SharedResources &shared, const ImageParams &p
 
     // Format time to only show hours:minutes:seconds
     std::tm timeInfo;
+#ifdef _WIN32
     localtime_s(&timeInfo, &time_t_now);
+#else
+    localtime_r(&time_t_now, &timeInfo);
+#endif
     char buffer[9]; // HH:MM:SS + null terminator
     strftime(buffer, sizeof(buffer), "%H:%M:%S", &timeInfo);
     shared.backgroundCaptureTime = std::string(buffer) + " (auto)"; // Indicate this was automatic initialization
 }
 
+void initializeMockBackgroundFrame(SharedResources &shared, const MockFrameSet &mock)
+{
+    initializeMockBackgroundFrame(shared, mock.params, mock.backgrounds ? *mock.backgrounds : *mock.frames);
+}
+
+MockFrameSet openMockFrames(const std::string &directory)
+{
+    MockFrameSet mock;
+
+    std::string imagesFile;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        std::string fname = entry.path().filename().string();
+        if (fname.size() > 11 && fname.substr(fname.size() - 11) == "_images.bin")
+        {
+            imagesFile = entry.path().string();
+            break;
+        }
+    }
+
+    if (imagesFile.empty())
+    {
+        json config = readConfig("config.json");
+        if (config.value("image_cache", true))
+        {
+            try
+            {
+                auto frames = openImageCache(directory, config);
+                mock.params.width = frames->width();
+                mock.params.height = frames->height();
+                mock.params.pixelFormat = frames->type();
+                mock.params.imageSize = frames->frameSize();
+                mock.params.bufferCount = config.value("simCameraTargetFPS", 5000);
+                mock.frames = std::move(frames);
+                mock.origin = "directory";
+                return mock;
+            }
+            catch (const std::exception &e)
+            {
+                // E.g. a read-only directory, decode into memory as before
+                std::cerr << "Frame cache unavailable: " << e.what() << std::endl;
+            }
+        }
+
+        mock.params = initializeImageParams(directory);
+        mock.cameraBuffer = std::make_unique<CircularBuffer>(mock.params.bufferCount, mock.params.imageSize);
+        loadImages(directory, *mock.cameraBuffer, true);
+        mock.frames = std::make_unique<BufferFrameSequence>(*mock.cameraBuffer);
+        mock.origin = "directory";
+        return mock;
+    }
+
+    auto frames = std::make_unique<BinFrameSequence>(imagesFile);
+    if (frames->type() != CV_8UC1)
+    {
+        throw std::runtime_error("Only 8-bit grayscale recordings can be replayed: " + imagesFile);
+    }
+
+    json config = readConfig("config.json");
+    mock.params.width = frames->width();
+    mock.params.height = frames->height();
+    mock.params.pixelFormat = frames->type();
+    mock.params.imageSize = frames->frameSize();
+    mock.params.bufferCount = config.value("simCameraTargetFPS", 5000);
+
+    std::cout << "Replaying " << frames->frameCount() << " frames from " << imagesFile << " (memory-mapped)";
+    if (frames->skippedRecords() > 0)
+    {
+        std::cout << ", skipped " << frames->skippedRecords() << " records of a different size";
+    }
+    std::cout << std::endl;
+
+    // The recorded background belongs to the capture, prefer it over the first frame
+    std::string backgroundsFile = imagesFile.substr(0, imagesFile.size() - 11) + "_backgrounds.bin";
+    if (config.value("replay_background", true) && std::filesystem::exists(backgroundsFile))
+    {
+        try
+        {
+            auto backgrounds = std::make_unique<BinFrameSequence>(backgroundsFile, 1);
+            if (backgrounds->width() == frames->width() && backgrounds->height() == frames->height() &&
+                backgrounds->type() == frames->type())
+            {
+                mock.backgrounds = std::move(backgrounds);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Ignoring recorded backgrounds: " << e.what() << std::endl;
+        }
+    }
+
+    mock.frames = std::move(frames);
+    mock.origin = "bin replay";
+    return mock;
+}
+
 void saveQualifiedResultsToDisk(const std::vector<QualifiedResult> &results, const std::string &directory, const SharedResources &shared)
 {
     // Save condition from configuration
@@ -295,7 +543,7 @@ void saveQualifiedResultsToDisk(const std::vector<QualifiedResult> &results, con
     // Write header to master CSV if it's a new file
     if (!masterFileExists)
     {
-        masterCsvFile << "Batch,Condition,Timestamp_us,Deformability,Area,RingRatio,Brightness_Q1,Brightness_Q2,Brightness_Q3,Brightness_Q4\n";
+        masterCsvFile << "Batch,Condition,Timestamp_us,Deformability,Area,RingRatio,Brightness_Q1,Brightness_Q2,Brightness_Q3,Brightness_Q4,FrameId\n";
     }
 
     // Write header to master ROI CSV if it's a new file
@@ -359,7 +607,8 @@ void saveQualifiedResultsToDisk(const std::vector<QualifiedResult> &results, con
                       << result.brightness.q1 << ","
                       << result.brightness.q2 << ","
                       << result.brightness.q3 << ","
-                      << result.brightness.q4 << "\n";
+                      << result.brightness.q4 << ","
+                      << result.frameId << "\n";
 
         // Write to master images file
         int rows = result.originalImage.rows;
@@ -417,6 +666,54 @@ void saveQualifiedResultsToDisk(const std::vector<QualifiedResult> &results, con
     // std::cout << "Saved " << results.size() << " results to master files in " << directory << std::endl;
 }
 
+// Append this run's frame accounting so the analyzed throughput can be stated afterwards
+void saveFrameAccounting(const SharedResources &shared, const std::string &directory)
+{
+    if (directory.empty() || !std::filesystem::exists(directory))
+    {
+        return;
+    }
+
+    json config = readConfig("config.json");
+    std::string condition = config.value("save_directory", std::string("results"));
+    std::string accountingPath = directory + "/" + condition + "_frame_accounting.json";
+
+    json runs = json::array();
+    if (std::filesystem::exists(accountingPath))
+    {
+        std::ifstream accountingIn(accountingPath);
+        try
+        {
+            accountingIn >> runs;
+        }
+        catch (const std::exception &e)
+        {
+            runs = json::array();
+        }
+        if (!runs.is_array())
+        {
+            runs = json::array();
+        }
+    }
+
+    const auto &accounting = shared.frameAccounting;
+    runs.push_back({{"end_time_us", std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::system_clock::now().time_since_epoch())
+                                        .count()},
+                    {"process_every_frame", shared.processEveryFrame.load()},
+                    {"processing_workers", shared.processingWorkers.load()},
+                    {"processing_batch_size", shared.processingBatchSize.load()},
+                    {"acquired", accounting.acquired.load()},
+                    {"analyzed", accounting.analyzed.load()},
+                    {"camera_gaps", accounting.cameraGaps.load()},
+                    {"queue_overflows", accounting.queueOverflows.load()},
+                    {"analysis_drops", accounting.analysisDrops.load()},
+                    {"early_rejects", accounting.earlyRejects.load()}});
+
+    std::ofstream accountingOut(accountingPath);
+    accountingOut << std::setw(4) << runs << std::endl;
+}
+
 // New utility function to calculate metrics from saved images and output to CSV
 void calculateMetricsFromSavedData(const std::string &inputDirectory, const std::string &outputFilePath)
 {
@@ -838,6 +1135,7 @@ prefix_found:
                                  cv::Size(shared.processingConfig.gaussian_blur_size,
                                           shared.processingConfig.gaussian_blur_size),
                                  0);
+                publishPipelineSnapshot(shared);
 
                 // Contrast enhancement removed
             }
@@ -907,7 +1205,7 @@ prefix_found:
             // Process each image in this batch
             for (size_t i = 0; i < batchImages.size(); i++)
             {
-                cv::Mat processedImage(batchImages[i].rows, batchImages[i].cols, CV_8UC1);
+                cv::Mat processedImage = cv::Mat::zeros(batchImages[i].rows, batchImages[i].cols, CV_8UC1);
                 processFrame(batchImages[i], shared, processedImage, mats);
 
                 // First try with the current contour detection method
@@ -1162,6 +1460,7 @@ prefix_found:
                                  cv::Size(shared.processingConfig.gaussian_blur_size,
                                           shared.processingConfig.gaussian_blur_size),
                                  0);
+                publishPipelineSnapshot(shared);
 
                 // Contrast enhancement removed
             }
@@ -1275,7 +1574,7 @@ prefix_found:
                 imageFile.read(reinterpret_cast<char *>(image.data), rows * cols * image.elemSize());
 
                 // Process the image and calculate metrics
-                cv::Mat processedImage(rows, cols, CV_8UC1);
+                cv::Mat processedImage = cv::Mat::zeros(rows, cols, CV_8UC1);
                 processFrame(image, shared, processedImage, mats);
 
                 // First try with the current contour detection method
@@ -1664,6 +1963,15 @@ json readConfig(const std::string &filename)
             {"morph_iterations", 1},
             {"area_threshold_min", 250},
             {"area_threshold_max", 1000},
+            {"fused_preprocessing", true},
+            {"packed_morphology", true},
+            {"component_analysis", true},
+            {"early_reject", true},
+            {"reject_min_pixels", 50},
+            {"reject_max_pixels", -1},
+            {"multi_object", false},
+            {"parallel_objects_min", 4},
+            {"object_crop_margin", 4},
             {"filters", {{"enable_border_check", true}, {"enable_multiple_contours_check", true}, {"enable_area_range_check", true}, {"require_single_inner_contour", true}}}};
 
         config = {
@@ -1672,6 +1980,37 @@ json readConfig(const std::string &filename)
             {"displayFPS", 100},
             {"cameraTargetFPS", 15000},
             {"simCameraTargetFPS", 15000},
+            {"simCameraFreeRun", false},
+            {"simCameraSpinUs", 50},
+            {"replay_background", true},
+            {"image_cache", true},
+            {"image_decode_threads", 0},
+            {"mock_source", "directory"},
+            {"synthetic_width", 512},
+            {"synthetic_height", 96},
+            {"synthetic_frames", 1000},
+            {"synthetic_noise", 4.0},
+            {"synthetic_seed", 1},
+            {"synthetic_density", 0.8},
+            {"synthetic_border_fraction", 0.1},
+            {"synthetic_cell_radius", 16.0},
+            {"synthetic_ring_width", 4.0},
+            {"synthetic_radius_jitter", 0.1},
+            {"synthetic_deformation", 0.15},
+            {"synthetic_cell_contrast", 40.0},
+            {"synthetic_save_directory", ""},
+            {"zero_copy_acquisition", false},
+            {"zero_copy_history", "all"},
+            {"processing_workers", 1},
+            {"process_every_frame", false},
+            {"processing_batch_size", 1},
+            {"latency_budget_us", 0},
+            {"background_model", true},
+            {"background_sample_interval_ms", 20},
+            {"background_publish_interval_ms", 1000},
+            {"acquisition_mode", "on_demand"},
+            {"callback_threads", 2},
+            {"telemetry_interval_ms", 250},
             {"scatter_plot_enabled", false},
             {"histogram_enabled", true},
             {"focus_setpoint", 20.0},
@@ -1764,7 +2103,7 @@ ProcessingConfig getProcessingConfig(const json &config)
     bool enable_area_range_check = filters.contains("enable_area_range_check") ? filters["enable_area_range_check"].get<bool>() : true;
     bool require_single_inner_contour = filters.contains("require_single_inner_contour") ? filters["require_single_inner_contour"].get<bool>() : true;
 
-    return ProcessingConfig{
+    ProcessingConfig processingConfig{
         img_config["gaussian_blur_size"],
         img_config["bg_subtract_threshold"],
         img_config["morph_kernel_size"],
@@ -1775,6 +2114,16 @@ ProcessingConfig getProcessingConfig(const json &config)
         enable_multiple_contours_check,
         enable_area_range_check,
         require_single_inner_contour};
+    processingConfig.fused_preprocessing = img_config.value("fused_preprocessing", true);
+    processingConfig.packed_morphology = img_config.value("packed_morphology", true);
+    processingConfig.component_analysis = img_config.value("component_analysis", true);
+    processingConfig.early_reject = img_config.value("early_reject", true);
+    processingConfig.reject_min_pixels = img_config.value("reject_min_pixels", 50);
+    processingConfig.reject_max_pixels = img_config.value("reject_max_pixels", -1);
+    processingConfig.multi_object = img_config.value("multi_object", false);
+    processingConfig.parallel_objects_min = img_config.value("parallel_objects_min", 4);
+    processingConfig.object_crop_margin = img_config.value("object_crop_margin", 4);
+    return processingConfig;
 }
 
 // Function to update the background with current settings (contrast removed)
@@ -1980,15 +2329,20 @@ void updateBackgroundForReview(SharedResources &shared)
         return; // No background to update
     }
 
-    std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
+    {
+        std::lock_guard<std::mutex> lock(shared.backgroundFrameMutex);
 
-    // Apply Gaussian blur to the original background frame with batch-specific config
-    cv::GaussianBlur(shared.backgroundFrame, shared.blurredBackground,
-                     cv::Size(shared.processingConfig.gaussian_blur_size,
-                              shared.processingConfig.gaussian_blur_size),
-                     0);
+        // Apply Gaussian blur to the original background frame with batch-specific config
+        cv::GaussianBlur(shared.backgroundFrame, shared.blurredBackground,
+                         cv::Size(shared.processingConfig.gaussian_blur_size,
+                                  shared.processingConfig.gaussian_blur_size),
+                         0);
 
-    // Contrast enhancement removed
+        // Contrast enhancement removed
+    }
+
+    // The batch's ROI and config were loaded before its background
+    publishPipelineSnapshot(shared);
 }
 
 // Function to display keyboard controls
@@ -2024,9 +2378,8 @@ std::map<std::string, int> parseCSVHeaders(const std::string &headerLine)
     return headerMap;
 }
 
-void reviewSavedData()
+void reviewSavedData(const std::string &projectPath)
 {
-    std::string projectPath = MenuSystem::navigateAndSelectFolder();
     std::vector<std::filesystem::path> batchDirs;
     ProcessingConfig processingConfig;
 
@@ -2421,9 +2774,9 @@ prefix_found_review:
             bool recalcValid = false;
 
             // Process the current image
-            processedImage = cv::Mat(filteredImages[currentImageIndex].rows,
-                                     filteredImages[currentImageIndex].cols,
-                                     CV_8UC1);
+            processedImage = cv::Mat::zeros(filteredImages[currentImageIndex].rows,
+                                            filteredImages[currentImageIndex].cols,
+                                            CV_8UC1);
             processFrame(filteredImages[currentImageIndex], shared, processedImage, mats);
 
             // First try with the current contour detection method
@@ -2734,9 +3087,9 @@ prefix_found_review:
             bool recalcValid = false;
 
             // Process the current image
-            processedImage = cv::Mat(images[currentImageIndex].rows,
-                                     images[currentImageIndex].cols,
-                                     CV_8UC1);
+            processedImage = cv::Mat::zeros(images[currentImageIndex].rows,
+                                            images[currentImageIndex].cols,
+                                            CV_8UC1);
             processFrame(images[currentImageIndex], shared, processedImage, mats);
 
             // First try with the current contour detection method
@@ -0,0 +1,160 @@
+#include "image_processing/image_processing.h"
+#include <iostream>
+
+namespace
+{
+    // Random ROI of the frame. Every other one is stretched to the frame edges, where the
+    // kernels have to reflect like the OpenCV calls do.
+    cv::Rect randomRoi(cv::RNG &rng, cv::Size size, bool touchEdges)
+    {
+        int x0 = rng.uniform(0, size.width - 1);
+        int x1 = rng.uniform(x0 + 1, size.width + 1);
+        int y0 = rng.uniform(0, size.height - 1);
+        int y1 = rng.uniform(y0 + 1, size.height + 1);
+        if (touchEdges)
+        {
+            if (rng.uniform(0, 2))
+                x0 = 0;
+            else
+                x1 = size.width;
+            if (rng.uniform(0, 2))
+                y0 = 0;
+            else
+                y1 = size.height;
+        }
+        return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+    }
+
+    // The fused threshold kernels against GaussianBlur, subtract and threshold of the ROI view
+    int verifyThreshold(cv::RNG &rng, int trials)
+    {
+        int failures = 0;
+        for (const int blurSize : {3, 5})
+        {
+            const PipelineKernels kernels = selectPipelineKernels(ProcessingConfig(blurSize));
+            if (!kernels.threshold)
+            {
+                std::cout << "threshold: no fused kernel for blur " << blurSize << std::endl;
+                failures++;
+                continue;
+            }
+
+            ThreadLocalMats mats;
+            for (int trial = 0; trial < trials; trial++)
+            {
+                const cv::Size size(rng.uniform(8, 320), rng.uniform(4, 128));
+                cv::Mat image(size, CV_8UC1);
+                cv::Mat background(size, CV_8UC1);
+                cv::Mat blurredBackground;
+                rng.fill(background, cv::RNG::UNIFORM, 0, 256);
+                rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+                cv::GaussianBlur(background, blurredBackground, cv::Size(blurSize, blurSize), 0);
+                const cv::Rect roi = randomRoi(rng, size, trial % 2 == 0);
+                const int threshold = rng.uniform(0, 64);
+
+                cv::Mat blurred(size, CV_8UC1);
+                cv::Mat subtracted(size, CV_8UC1);
+                cv::Mat expected = cv::Mat::zeros(size, CV_8UC1);
+                cv::GaussianBlur(image(roi), blurred(roi), cv::Size(blurSize, blurSize), 0);
+                cv::subtract(blurred(roi), blurredBackground(roi), subtracted(roi));
+                cv::threshold(subtracted(roi), expected(roi), threshold, 255, cv::THRESH_BINARY);
+                ForegroundStats expectedStats;
+                countForeground(expected, roi, expectedStats);
+
+                cv::Mat binary = cv::Mat::zeros(size, CV_8UC1);
+                ForegroundStats stats;
+                const bool ran = kernels.threshold(image, roi, blurredBackground, threshold, binary, mats, &stats);
+                const int differing = ran ? cv::countNonZero(binary != expected) : -1;
+                if (differing != 0 || stats.pixels != expectedStats.pixels || stats.bbox != expectedStats.bbox)
+                {
+                    std::cout << "threshold: blur " << blurSize << ", " << size.width << "x" << size.height
+                              << " frame, roi " << roi << ", threshold " << threshold << ": "
+                              << (ran ? std::to_string(differing) + " pixels differ" : std::string("not run"))
+                              << ", foreground " << stats.pixels << " vs " << expectedStats.pixels << std::endl;
+                    failures++;
+                }
+            }
+        }
+        return failures;
+    }
+
+    // Packed close/open against the two morphologyEx calls. The packed kernels morph the ROI on
+    // its own, so the reference runs on a copy of it rather than on the ROI view, whose
+    // surroundings morphologyEx would read.
+    int verifyCloseOpen(cv::RNG &rng, int trials)
+    {
+        int failures = 0;
+        for (const int kernelSize : {3, 5})
+        {
+            for (const int iterations : {1, 2})
+            {
+                const PipelineKernels kernels = selectPipelineKernels(ProcessingConfig(3, 8, kernelSize, iterations));
+                const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(kernelSize, kernelSize));
+                if (!kernels.closeOpen)
+                {
+                    std::cout << "close/open: no packed kernel for cross " << kernelSize << " x" << iterations << std::endl;
+                    failures++;
+                }
+
+                ThreadLocalMats mats;
+                for (int trial = 0; trial < trials; trial++)
+                {
+                    // Sparse specks, filled blobs and rings, as the threshold leaves them
+                    const cv::Size size(rng.uniform(16, 320), rng.uniform(8, 128));
+                    cv::Mat noise(size, CV_8UC1);
+                    rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+                    cv::Mat binary;
+                    cv::threshold(noise, binary, rng.uniform(128, 250), 255, cv::THRESH_BINARY);
+                    for (int blob = rng.uniform(0, 6); blob > 0; blob--)
+                    {
+                        const cv::Point centre(rng.uniform(0, size.width), rng.uniform(0, size.height));
+                        const int radius = rng.uniform(2, 20);
+                        cv::circle(binary, centre, radius, cv::Scalar(255), rng.uniform(0, 2) ? -1 : rng.uniform(1, 4));
+                    }
+
+                    // Interior ROI: at least one pixel of frame around it on every side
+                    cv::Rect roi = randomRoi(rng, cv::Size(size.width - 2, size.height - 2), false);
+                    roi.x += 1;
+                    roi.y += 1;
+
+                    cv::Mat isolated = binary(roi).clone();
+                    cv::Mat closed;
+                    cv::Mat expected;
+                    cv::morphologyEx(isolated, closed, cv::MORPH_CLOSE, kernel, cv::Point(-1, -1), iterations);
+                    cv::morphologyEx(closed, expected, cv::MORPH_OPEN, kernel, cv::Point(-1, -1), iterations);
+
+                    // The specialized instance and the generic packed version both have to match
+                    for (const bool specialized : {true, false})
+                    {
+                        if (specialized && !kernels.closeOpen)
+                            continue;
+                        cv::Mat output = cv::Mat::zeros(size, CV_8UC1);
+                        const bool ran = specialized ? kernels.closeOpen(binary, roi, output, mats)
+                                                     : packedCloseOpen(binary, roi, kernel, iterations, output, mats);
+                        const int differing = ran ? cv::countNonZero(output(roi) != expected) : -1;
+                        if (differing != 0)
+                        {
+                            std::cout << "close/open: " << (specialized ? "cross " : "packed ") << kernelSize << " x"
+                                      << iterations << ", " << size.width << "x" << size.height << " frame, roi " << roi
+                                      << ": " << (ran ? std::to_string(differing) + " pixels differ" : std::string("not run"))
+                                      << std::endl;
+                            failures++;
+                        }
+                    }
+                }
+            }
+        }
+        return failures;
+    }
+}
+
+int verifyPipelineKernels(unsigned seed)
+{
+    cv::RNG rng(seed);
+    const int trials = 200;
+    int failures = verifyThreshold(rng, trials);
+    failures += verifyCloseOpen(rng, trials);
+    std::cout << "Pipeline kernels: " << (failures ? std::to_string(failures) + " cases differ" : std::string("all cases match"))
+              << std::endl;
+    return failures;
+}
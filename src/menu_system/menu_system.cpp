@@ -11,6 +11,7 @@
 #include <ftxui/component/screen_interactive.hpp>
 #include <filesystem>
 #include "mib_grabber/mib_grabber.h"
+#include "acquisition/acquisition.h"
 #include <iomanip>
 #include <sstream>
 
@@ -211,23 +212,24 @@ namespace MenuSystem
 
     void runMockSample()
     {
+        json config = readConfig("config.json");
+        // "synthetic" generates frames instead of loading a folder
+        const bool synthetic = config.value("mock_source", std::string("directory")) == "synthetic";
 
-        std::cout << "Select the image directory:\n";
-        std::string imageDirectory = navigateAndSelectFolder();
+        std::string imageDirectory;
+        if (!synthetic)
+        {
+            std::cout << "Select the image directory:\n";
+            imageDirectory = navigateAndSelectFolder();
+        }
 
         try
         {
-            ImageParams params = initializeImageParams(imageDirectory);
-            CircularBuffer cameraBuffer(params.bufferCount, params.imageSize);
-            CircularBuffer circularBuffer(params.bufferCount, params.imageSize);
-            CircularBuffer processingBuffer(params.bufferCount, params.imageSize);
-            loadImages(imageDirectory, cameraBuffer, true);
+            MockFrameSet frames = synthetic ? makeSyntheticFrames(config) : openMockFrames(imageDirectory);
+            std::unique_ptr<FrameSource> source = makeMockFrameSource(std::move(frames), config);
 
             SharedResources shared;
-            initializeMockBackgroundFrame(shared, params, cameraBuffer);
-            shared.roi = cv::Rect(0, 0, static_cast<int>(params.width), static_cast<int>(params.height));
-
-            temp_mockSample(params, cameraBuffer, circularBuffer, processingBuffer, shared);
+            runFrameSource(*source, shared);
 
             std::cout << "Mock sampling completed.\n";
         }
@@ -591,7 +593,7 @@ namespace MenuSystem
                 runHybridSample();
                 break;
             case 3:
-                reviewSavedData();
+                reviewSavedData(navigateAndSelectFolder());
                 break;
             case 4:
                 calculateMetrics();
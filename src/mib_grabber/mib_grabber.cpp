@@ -13,7 +13,10 @@
 #include <chrono>
 #include <iomanip>
 #include <CircularBuffer/CircularBuffer.h>
+#include <FramePool/FramePool.h>
+#include <acquisition/acquisition.h>
 #include <tuple>
+#include <memory>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <image_processing/image_processing.h>
@@ -147,14 +150,16 @@ void initializeBackgroundFrame(SharedResources &shared, const ImageParams &param
     cv::GaussianBlur(shared.backgroundFrame, shared.blurredBackground, cv::Size(3, 3), 0);
 }
 
-void triggerOut(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared)
+template <typename Grabber>
+void triggerOut(Grabber &grabber, SharedResources &shared)
 {
     // grabber.setString<InterfaceModule>("LineSelector", "TTLIO12");
     // grabber.setString<InterfaceModule>("LineMode", "Output");
-    grabber.setString<InterfaceModule>("LineSource", shared.manualTriggerEnabled.load() ? "High" : "Low");
+    grabber.template setString<InterfaceModule>("LineSource", shared.manualTriggerEnabled.load() ? "High" : "Low");
 }
 
-void triggerThread(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared)
+template <typename Grabber>
+void triggerThread(Grabber &grabber, SharedResources &shared)
 {
     // Event-driven manual trigger: follow manualTriggerEnabled changes immediately
     while (!shared.done)
@@ -179,9 +184,10 @@ void triggerThread(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared)
     std::cout << "Trigger thread interrupted." << std::endl;
 }
 
-void processTrigger(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared)
+template <typename Grabber>
+void processTrigger(Grabber &grabber, SharedResources &shared)
 {
-    if (shared.processTrigger && shared.validProcessingFrame)
+    if (shared.processTrigger)
     {
         // track how long it takes to set the line source high
         auto trigger_start = std::chrono::high_resolution_clock::now();
@@ -189,7 +195,7 @@ void processTrigger(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared
         // grabber.setString<InterfaceModule>("LineMode", "Output");
         if (shared.done)
             return;
-        grabber.setString<InterfaceModule>("LineSource", "High");
+        grabber.template setString<InterfaceModule>("LineSource", "High");
         auto trigger_end = std::chrono::high_resolution_clock::now();
         auto trigger_onset_duration = std::chrono::duration_cast<std::chrono::microseconds>(trigger_end - trigger_start);
 
@@ -204,16 +210,17 @@ void processTrigger(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared
         }
         if (!shared.done)
         {
-            grabber.setString<InterfaceModule>("LineSource", "Low");
+            grabber.template setString<InterfaceModule>("LineSource", "Low");
         }
         shared.processTrigger = false;
     }
 }
 
-void processTriggerThread(EGrabber<CallbackOnDemand> &grabber, SharedResources &shared)
+template <typename Grabber>
+void processTriggerThread(Grabber &grabber, SharedResources &shared)
 {
-    grabber.setString<InterfaceModule>("LineSelector", "TTLIO12");
-    grabber.setString<InterfaceModule>("LineMode", "Output");
+    grabber.template setString<InterfaceModule>("LineSelector", "TTLIO12");
+    grabber.template setString<InterfaceModule>("LineMode", "Output");
     while (!shared.done)
     {
         {
@@ -236,133 +243,308 @@ void processTriggerThread(EGrabber<CallbackOnDemand> &grabber, SharedResources &
     std::cout << "Process trigger thread interrupted." << std::endl;
 }
 
-void hybrid_sample(EGrabber<CallbackOnDemand> &grabber, const ImageParams &params, CircularBuffer &cameraBuffer, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared)
+template <typename Grabber>
+AcquisitionTelemetry pollTelemetry(Grabber &grabber)
 {
-    commonSampleLogic(shared, "default_save_directory", [&](SharedResources &shared, const std::string &saveDir)
-                      {
-                          std::vector<std::thread> threads;
-                          setupCommonThreads(shared, saveDir, circularBuffer, processingBuffer, params, threads);
-                          threads.emplace_back(simulateCameraThread, std::ref(cameraBuffer), std::ref(shared), std::ref(params));
-                          threads.emplace_back(triggerThread, std::ref(grabber), std::ref(shared));
-                          threads.emplace_back(processTriggerThread, std::ref(grabber), std::ref(shared));
-
-                          grabber.start();
-                          size_t lastProcessedFrame = 0;
-                          while (!shared.done)
-                          {
-                              if (shared.paused)
-                              {
-                                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                                  continue;
-                              }
-                              size_t latestFrame = shared.latestCameraFrame.load(std::memory_order_acquire);
-                              if (latestFrame != lastProcessedFrame)
-                              {
-                                  const uint8_t *imageData = cameraBuffer.getPointer(latestFrame);
-                                  if (imageData != nullptr)
-                                  {
-                                      circularBuffer.push(imageData);
-                                      processingBuffer.push(imageData);
-                                      {
-                                          std::lock_guard<std::mutex> displayLock(shared.displayQueueMutex);
-                                          std::lock_guard<std::mutex> processingLock(shared.processingQueueMutex);
-                                          shared.framesToProcess.push(latestFrame);
-                                          shared.framesToDisplay.push(latestFrame);
-                                      }
-                                      shared.displayQueueCondition.notify_one();
-                                      shared.processingQueueCondition.notify_one();
-                                      lastProcessedFrame = latestFrame;
-                                  }
-                              }
-                          }
-                          grabber.stop();
-                          return threads; });
+    AcquisitionTelemetry telemetry;
+    telemetry.frameRate = static_cast<double>(grabber.template getInteger<StreamModule>("StatisticsFrameRate"));
+    telemetry.dataRate = static_cast<double>(grabber.template getInteger<StreamModule>("StatisticsDataRate"));
+    telemetry.exposureTime = grabber.template getInteger<RemoteModule>("ExposureTime");
+    return telemetry;
 }
 
-void temp_sample(EGrabber<CallbackOnDemand> &grabber, const ImageParams &params, CircularBuffer &circularBuffer, CircularBuffer &processingBuffer, SharedResources &shared)
+static std::chrono::milliseconds telemetryInterval(const json &config)
 {
-    commonSampleLogic(shared, "default_save_directory", [&](SharedResources &shared, const std::string &saveDir)
-                      {
-                          std::vector<std::thread> threads;
-                          setupCommonThreads(shared, saveDir, circularBuffer, processingBuffer, params, threads);
-                          
-                          threads.emplace_back(triggerThread, std::ref(grabber), std::ref(shared)); // previous testing trigger 
-                          threads.emplace_back(processTriggerThread, std::ref(grabber), std::ref(shared));
-
-                          grabber.start();
-                          // egrabber request fps and exposure time load to shared.resources for metric display
-                          uint64_t fr = grabber.getInteger<StreamModule>("StatisticsFrameRate");
-                          uint64_t dr = grabber.getInteger<StreamModule>("StatisticsDataRate");
-                          // Get exposure time
-                          uint64_t exposureTime = grabber.getInteger<RemoteModule>("ExposureTime");
-                          shared.currentFPS = static_cast<double>(fr);
-                          shared.dataRate = static_cast<double>(dr);
-                          shared.exposureTime = exposureTime;
-                          size_t frameCount = 0;
-                          uint64_t lastFrameId = 0;
-                          uint64_t duplicateCount = 0;
-                          while (!shared.done)
-                          {
-                              if (shared.paused)
-                              {
-                                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                                  cv::waitKey(1);
-                                  continue;
-                              }
-
-                              // Update FPS and other metrics periodically (every 100 frames or so)
-                              if (frameCount % 100 == 0)
-                              {
-                                  uint64_t fr = grabber.getInteger<StreamModule>("StatisticsFrameRate");
-                                  uint64_t dr = grabber.getInteger<StreamModule>("StatisticsDataRate");
-                                  uint64_t exposureTime = grabber.getInteger<RemoteModule>("ExposureTime");
-                                  shared.currentFPS = static_cast<double>(fr);
-                                  shared.dataRate = static_cast<double>(dr);
-                                  shared.exposureTime = exposureTime;
-                                  shared.updated = true;
-                              }
-
-                              ScopedBuffer buffer(grabber);
-                              uint8_t *imagePointer = buffer.getInfo<uint8_t *>(gc::BUFFER_INFO_BASE);
-                              uint64_t frameId = buffer.getInfo<uint64_t>(gc::BUFFER_INFO_FRAMEID);
-                              uint64_t timestamp = buffer.getInfo<uint64_t>(gc::BUFFER_INFO_TIMESTAMP);
-                              bool isIncomplete = buffer.getInfo<bool>(gc::BUFFER_INFO_IS_INCOMPLETE);
-                              size_t sizeFilled = buffer.getInfo<size_t>(gc::BUFFER_INFO_SIZE_FILLED);
-
-                              if (!isIncomplete)
-                              {
-                                  if (frameId <= lastFrameId)
-                                  {
-                                      ++duplicateCount;
-                                      //   std::cout << "Duplicate frame detected: FrameID=" << frameId << ", Timestamp=" << timestamp << std::endl;
-                                  }
-                                  else
-                                  {
-                                      circularBuffer.push(imagePointer);
-                                      processingBuffer.push(imagePointer);
-                                      {
-                                          std::lock_guard<std::mutex> displayLock(shared.displayQueueMutex);
-                                          std::lock_guard<std::mutex> processingLock(shared.processingQueueMutex);
-                                          shared.framesToProcess.push(frameCount);
-                                          shared.framesToDisplay.push(frameCount);
-                                      }
-                                      shared.displayQueueCondition.notify_one();
-                                      shared.processingQueueCondition.notify_one();
-                                      frameCount++;
-                                  }
-                                  lastFrameId = frameId;
-                              }
-                              else
-                              {
-                                  //   std::cout << "Incomplete frame received: FrameID=" << frameId << std::endl;
-                              }
-                          }
-
-                          grabber.stop();
-
-                          return threads; });
+    return std::chrono::milliseconds(std::max(10, config.value("telemetry_interval_ms", 250)));
 }
 
+// EGrabber driven by onNewBufferEvent instead of pop(). With CallbackSingleThread one
+// EGrabber thread delivers every buffer, with CallbackMultiThread each buffer gets its own.
+template <typename CallbackModel>
+class EventGrabber : public EGrabber<CallbackModel>
+{
+public:
+    explicit EventGrabber(const EGrabberCameraInfo &camera) : EGrabber<CallbackModel>(camera)
+    {
+        this->template enableEvent<NewBufferData>();
+    }
+
+    ~EventGrabber() { this->shutdown(); }
+
+    // Must be set before start() and outlive the grabber
+    void setDelivery(FrameDelivery *delivery) { delivery_ = delivery; }
+
+private:
+    void onNewBufferEvent(const NewBufferData &data) override
+    {
+        // The buffer goes back to the grabber when this scope ends, FrameDelivery copies it first
+        ScopedBuffer buffer(*this, data);
+        delivery_->onFrame(buffer.template getInfo<uint8_t *>(gc::BUFFER_INFO_BASE),
+                           buffer.template getInfo<uint64_t>(gc::BUFFER_INFO_FRAMEID),
+                           buffer.template getInfo<uint64_t>(gc::BUFFER_INFO_TIMESTAMP),
+                           buffer.template getInfo<bool>(gc::BUFFER_INFO_IS_INCOMPLETE));
+    }
+
+    FrameDelivery *delivery_ = nullptr;
+};
+
+// Live camera through EGrabber callbacks. Callback buffers are requeued when the handler
+// returns, so frames are always copied.
+template <typename CallbackModel>
+class EventGrabberSource : public FrameSource
+{
+public:
+    EventGrabberSource(const EGrabberCameraInfo &camera, const ImageParams &params, const json &config)
+        : params_(params), telemetryInterval_(telemetryInterval(config)), grabber_(camera)
+    {
+        grabber_.reallocBuffers(config.value("callback_buffer_count", 256));
+    }
+
+    std::string name() const override { return "callback grabber"; }
+    const ImageParams &params() const override { return params_; }
+    void initializeBackground(SharedResources &shared) override { initializeBackgroundFrame(shared, params_); }
+
+    void startThreads(SharedResources &shared, std::vector<std::thread> &threads) override
+    {
+        threads.emplace_back(triggerThread<EventGrabber<CallbackModel>>, std::ref(grabber_), std::ref(shared));
+        threads.emplace_back(processTriggerThread<EventGrabber<CallbackModel>>, std::ref(grabber_), std::ref(shared));
+        threads.emplace_back(telemetryThread, std::ref(shared),
+                             [this]()
+                             { return pollTelemetry(grabber_); },
+                             telemetryInterval_);
+    }
+
+    void run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging) override
+    {
+        delivery_ = std::make_unique<FrameDelivery>(shared, historyBuffer, *staging);
+        grabber_.setDelivery(delivery_.get());
+
+        // Frames arrive through onNewBufferEvent, this thread only waits for shutdown
+        grabber_.start();
+        while (!shared.done)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        grabber_.stop();
+    }
+
+    void printSummary() const override
+    {
+        if (delivery_)
+        {
+            std::cout << "Callback acquisition: " << delivery_->duplicateCount() << " duplicate, "
+                      << delivery_->incompleteCount() << " incomplete frames" << std::endl;
+        }
+    }
+
+private:
+    ImageParams params_;
+    std::chrono::milliseconds telemetryInterval_;
+    // Declared before the grabber so it outlives every callback
+    std::unique_ptr<FrameDelivery> delivery_;
+    EventGrabber<CallbackModel> grabber_;
+};
+
+// Announced buffer count for zero-copy acquisition. Every grabber buffer doubles as a frame pool
+// slot, so there must be enough of them to cover what downstream can hold at the camera rate.
+static size_t zeroCopyBufferCount(const json &config)
+{
+    const size_t configured = config.value("zero_copy_buffer_count", 0);
+    if (configured > 0)
+    {
+        return configured;
+    }
+    const size_t cameraTargetFPS = config.value("cameraTargetFPS", 5000);
+    const size_t holdMs = config.value("zero_copy_hold_ms", 20); // Worst-case time a frame stays referenced
+    return std::max<size_t>(16, cameraTargetFPS * holdMs / 1000);
+}
+
+// Live camera through EGrabber::pop(). With zero_copy_acquisition the grabber buffers double
+// as frame pool slots and go to the workers without a copy.
+class OnDemandGrabberSource : public FrameSource
+{
+public:
+    OnDemandGrabberSource(EGrabber<CallbackOnDemand> &grabber, const ImageParams &params, const json &config)
+        : grabber_(grabber), params_(params), telemetryInterval_(telemetryInterval(config)),
+          // "all" keeps every frame in the history ring for paused review, "display" only copies frames the live view asks for
+          historyEveryFrame_(config.value("zero_copy_history", std::string("all")) != "display")
+    {
+        if (config.value("zero_copy_acquisition", false))
+        {
+            const size_t bufferCount = zeroCopyBufferCount(config);
+            grabber_.reallocBuffers(bufferCount);
+            framePool_ = std::make_unique<FramePool>(bufferCount);
+            slotBuffers_.resize(bufferCount);
+            std::cout << "Zero-copy acquisition with " << bufferCount << " grabber buffers" << std::endl;
+        }
+    }
+
+    std::string name() const override { return framePool_ ? "on-demand grabber (zero-copy)" : "on-demand grabber"; }
+    const ImageParams &params() const override { return params_; }
+    void initializeBackground(SharedResources &shared) override { initializeBackgroundFrame(shared, params_); }
+    FramePool *framePool() override { return framePool_.get(); }
+
+    void startThreads(SharedResources &shared, std::vector<std::thread> &threads) override
+    {
+        threads.emplace_back(triggerThread<EGrabber<CallbackOnDemand>>, std::ref(grabber_), std::ref(shared)); // previous testing trigger
+        threads.emplace_back(processTriggerThread<EGrabber<CallbackOnDemand>>, std::ref(grabber_), std::ref(shared));
+        threads.emplace_back(telemetryThread, std::ref(shared),
+                             [this]()
+                             { return pollTelemetry(grabber_); },
+                             telemetryInterval_);
+    }
+
+    void run(SharedResources &shared, CircularBuffer &circularBuffer, FrameStaging *staging) override
+    {
+        grabber_.start();
+        uint64_t lastFrameId = 0;
+        while (!shared.done)
+        {
+            if (shared.paused)
+            {
+                shared.hasAcquiredFrame = false; // Frames missed while paused are not camera gaps
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                cv::waitKey(1);
+                continue;
+            }
+
+            if (framePool_)
+            {
+                // Requeue grabber buffers whose last frame handle has been dropped
+                framePool_->reclaim([&](size_t slot)
+                                    { Buffer(slotBuffers_[slot]).push(grabber_); });
+
+                // Once every buffer is out with the workers nothing new arrives, so the wait is
+                // short and the slots they released meanwhile get requeued on the next pass
+                NewBufferData bufferData;
+                try
+                {
+                    bufferData = grabber_.pop(popTimeoutMs);
+                }
+                catch (const gentl_error &e)
+                {
+                    if (e.gc_err == gc::GC_ERR_TIMEOUT)
+                        continue;
+                    throw;
+                }
+                Buffer buffer(bufferData);
+                uint8_t *imagePointer = buffer.getInfo<uint8_t *>(grabber_, gc::BUFFER_INFO_BASE);
+                uint64_t frameId = buffer.getInfo<uint64_t>(grabber_, gc::BUFFER_INFO_FRAMEID);
+                uint64_t timestamp = buffer.getInfo<uint64_t>(grabber_, gc::BUFFER_INFO_TIMESTAMP);
+                bool isIncomplete = buffer.getInfo<bool>(grabber_, gc::BUFFER_INFO_IS_INCOMPLETE);
+
+                size_t slot = 0;
+                if (isIncomplete || frameId <= lastFrameId || !framePool_->acquire(slot))
+                {
+                    if (!isIncomplete)
+                    {
+                        if (frameId <= lastFrameId)
+                            ++duplicateCount_;
+                        else
+                        {
+                            shared.framePoolExhausted.fetch_add(1, std::memory_order_relaxed);
+                            accountDroppedFrame(shared, frameId);
+                        }
+                        lastFrameId = frameId;
+                    }
+                    buffer.push(grabber_);
+                    continue;
+                }
+                lastFrameId = frameId;
+
+                slotBuffers_[slot] = bufferData;
+                framePool_->publish(slot, imagePointer, frameId, timestamp);
+
+                // The history ring is the only copy left; skip it while the live view is still behind
+                const bool copyToHistory = historyEveryFrame_ || shared.displayRing.empty();
+                if (copyToHistory)
+                {
+                    circularBuffer.push(imagePointer);
+                }
+                FrameDescriptor descriptor;
+                descriptor.slot = slot;
+                descriptor.frameId = frameId;
+                descriptor.timestamp = timestamp;
+                descriptor.enqueueNs = steadyNowNs();
+                if (!dispatchFrame(shared, descriptor, copyToHistory))
+                {
+                    // Processing ring full, hand the buffer straight back
+                    framePool_->adopt(slot);
+                }
+                continue;
+            }
+
+            ScopedBuffer buffer(grabber_);
+            uint8_t *imagePointer = buffer.getInfo<uint8_t *>(gc::BUFFER_INFO_BASE);
+            uint64_t frameId = buffer.getInfo<uint64_t>(gc::BUFFER_INFO_FRAMEID);
+            uint64_t timestamp = buffer.getInfo<uint64_t>(gc::BUFFER_INFO_TIMESTAMP);
+            bool isIncomplete = buffer.getInfo<bool>(gc::BUFFER_INFO_IS_INCOMPLETE);
+
+            if (!isIncomplete)
+            {
+                if (frameId <= lastFrameId)
+                {
+                    ++duplicateCount_;
+                }
+                else
+                {
+                    circularBuffer.push(imagePointer);
+                    FrameDescriptor descriptor;
+                    descriptor.frameId = frameId;
+                    descriptor.timestamp = timestamp;
+                    descriptor.enqueueNs = steadyNowNs();
+                    dispatchStagedFrame(shared, *staging, imagePointer, descriptor);
+                }
+                lastFrameId = frameId;
+            }
+        }
+
+        grabber_.stop();
+    }
+
+    void printSummary() const override
+    {
+        std::cout << "On-demand acquisition: " << duplicateCount_ << " duplicate frames" << std::endl;
+    }
+
+private:
+    EGrabber<CallbackOnDemand> &grabber_;
+    ImageParams params_;
+    std::chrono::milliseconds telemetryInterval_;
+    bool historyEveryFrame_;
+    std::unique_ptr<FramePool> framePool_;
+    std::vector<NewBufferData> slotBuffers_;
+    uint64_t duplicateCount_ = 0;
+    static constexpr uint64_t popTimeoutMs = 10; // Zero-copy only, see run
+};
+
+// Simulated camera frames, while the real grabber only drives the trigger lines
+class HybridGrabberSource : public SequenceFrameSource
+{
+public:
+    HybridGrabberSource(EGrabber<CallbackOnDemand> &grabber, MockFrameSet frames, const json &config)
+        : SequenceFrameSource(std::move(frames), config), grabber_(grabber)
+    {
+        name_ = "hybrid (" + name_ + ")";
+    }
+
+    void startThreads(SharedResources &shared, std::vector<std::thread> &threads) override
+    {
+        threads.emplace_back(triggerThread<EGrabber<CallbackOnDemand>>, std::ref(grabber_), std::ref(shared));
+        threads.emplace_back(processTriggerThread<EGrabber<CallbackOnDemand>>, std::ref(grabber_), std::ref(shared));
+    }
+
+    void run(SharedResources &shared, CircularBuffer &historyBuffer, FrameStaging *staging) override
+    {
+        grabber_.start();
+        SequenceFrameSource::run(shared, historyBuffer, staging);
+        grabber_.stop();
+    }
+
+private:
+    EGrabber<CallbackOnDemand> &grabber_;
+};
+
 void runHybridSample()
 {
     try
@@ -385,17 +567,10 @@ void runHybridSample()
 
         std::cout << "Select the image directory:\n";
         std::string imageDirectory = MenuSystem::navigateAndSelectFolder();
-        ImageParams params = initializeImageParams(imageDirectory);
-        CircularBuffer cameraBuffer(params.bufferCount, params.imageSize);
-        CircularBuffer circularBuffer(params.bufferCount, params.imageSize);
-        CircularBuffer processingBuffer(params.bufferCount, params.imageSize);
-        loadImages(imageDirectory, cameraBuffer, true);
+        HybridGrabberSource source(grabber, openMockFrames(imageDirectory), readConfig("config.json"));
 
         SharedResources shared;
-        initializeMockBackgroundFrame(shared, params, cameraBuffer);
-        shared.roi = cv::Rect(0, 0, static_cast<int>(params.width), static_cast<int>(params.height));
-
-        hybrid_sample(grabber, params, cameraBuffer, circularBuffer, processingBuffer, shared);
+        runFrameSource(source, shared);
 
         std::cout << "Hybrid sampling completed.\n";
     }
@@ -421,17 +596,37 @@ int mib_grabber_main()
         EGenTL genTL;
         EGrabberDiscovery discovery(genTL);
         discovery.discover();
+        json config = readConfig("config.json");
+        // "on_demand" pops buffers in a loop, "callback_single"/"callback_multi" are event driven
+        const std::string acquisitionMode = config.value("acquisition_mode", std::string("on_demand"));
+        if (acquisitionMode == "callback_single" || acquisitionMode == "callback_multi")
+        {
+            ImageParams params;
+            {
+                EGrabber<CallbackOnDemand> probe(discovery.cameras(selectedCamera));
+                params = initializeGrabber(probe);
+            }
+            SharedResources shared;
+            if (acquisitionMode == "callback_multi")
+            {
+                EventGrabberSource<CallbackMultiThread> source(discovery.cameras(selectedCamera), params, config);
+                runFrameSource(source, shared);
+            }
+            else
+            {
+                EventGrabberSource<CallbackSingleThread> source(discovery.cameras(selectedCamera), params, config);
+                runFrameSource(source, shared);
+            }
+            return 0;
+        }
+
         EGrabber<CallbackOnDemand> grabber(discovery.cameras(selectedCamera));
 
         // Continue with your existing initialization and grabbing logic
         ImageParams params = initializeGrabber(grabber);
-        CircularBuffer circularBuffer(params.bufferCount, params.imageSize);
-        CircularBuffer processingBuffer(params.bufferCount, params.imageSize);
+        OnDemandGrabberSource source(grabber, params, config);
         SharedResources shared;
-        initializeBackgroundFrame(shared, params);
-        shared.roi = cv::Rect(0, 0, static_cast<int>(params.width), static_cast<int>(params.height));
-
-        temp_sample(grabber, params, circularBuffer, processingBuffer, shared);
+        runFrameSource(source, shared);
     }
     catch (const std::exception &e)
     {